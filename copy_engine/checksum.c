@@ -0,0 +1,124 @@
+#include <string.h>
+#include "checksum.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define CRC32C_HW 1
+#endif
+
+#define POLY 0x82f63b78     /* reversed Castagnoli polynomial */
+
+static uint32_t table[8][256];
+static uint32_t x2n[67];        /* x^(2^k) mod P, enough for 2^64 bytes */
+
+static void build_table(void){
+    for (uint32_t n = 0; n < 256; n++){
+	uint32_t crc = n;
+	for (int k = 0; k < 8; k++)
+	    crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+	table[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; n++)
+	for (int k = 1; k < 8; k++)
+	    table[k][n] = (table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xff];
+}
+
+/* a * b mod P, bit reversed like the crc itself (x^0 is the top bit) */
+static uint32_t multmodp(uint32_t a, uint32_t b){
+    uint32_t p = 0;
+    for (uint32_t m = 1u << 31; m; m >>= 1){
+	if(a & m)
+	    p ^= b;
+	b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
+
+static void build_x2n(void){
+    x2n[0] = 1u << 30;          /* x^1 */
+    for (int k = 1; k < 67; k++)
+	x2n[k] = multmodp(x2n[k - 1], x2n[k - 1]);
+}
+
+/* 8 bytes per step, one lookup per byte in 8 different tables */
+static uint32_t crc32c_table(uint32_t crc, const void *buf, size_t len){
+    const unsigned char *p = buf;
+    crc = ~crc;
+    for (; len >= 8; len -= 8, p += 8){
+	uint64_t word;
+	memcpy(&word, p, 8);
+	word ^= crc;    /* little endian: the crc covers the first 4 bytes */
+	crc = table[7][word & 0xff] ^ table[6][(word >> 8) & 0xff]
+	    ^ table[5][(word >> 16) & 0xff] ^ table[4][(word >> 24) & 0xff]
+	    ^ table[3][(word >> 32) & 0xff] ^ table[2][(word >> 40) & 0xff]
+	    ^ table[1][(word >> 48) & 0xff] ^ table[0][word >> 56];
+    }
+    while(len--)
+	crc = (crc >> 8) ^ table[0][(crc ^ *p++) & 0xff];
+    return ~crc;
+}
+
+#ifdef CRC32C_HW
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const void *buf, size_t len){
+    const unsigned char *p = buf;
+    uint64_t c = ~crc;
+    for (; len >= 8; len -= 8, p += 8){
+	uint64_t word;
+	memcpy(&word, p, 8);
+	c = _mm_crc32_u64(c, word);
+    }
+    uint32_t c32 = c;
+    while(len--)
+	c32 = _mm_crc32_u8(c32, *p++);
+    return ~c32;
+}
+#endif
+
+static crc32c_fn impl;
+
+__attribute__((constructor))
+static void crc32c_init(void){
+    build_table();
+    build_x2n();
+    impl = crc32c_table;
+#ifdef CRC32C_HW
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse4.2"))
+	impl = crc32c_hw;
+#endif
+}
+
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len){
+    return impl(crc, buf, len);
+}
+
+/* zeros leave the crc register multiplied by x^(8 len) mod P, built
+   from the squares in x2n: one multiplication per set bit of len */
+uint32_t crc32c_zeros_op(uint64_t len){
+    uint32_t op = 1u << 31;     /* x^0 */
+    for (int k = 3; len; len >>= 1, k++)
+	if(len & 1)
+	    op = multmodp(x2n[k], op);
+    return op;
+}
+
+uint32_t crc32c_zeros_apply(uint32_t crc, uint32_t op){
+    return ~multmodp(op, ~crc);
+}
+
+uint32_t crc32c_zeros(uint32_t crc, uint64_t len){
+    return crc32c_zeros_apply(crc, crc32c_zeros_op(len));
+}
+
+crc32c_fn crc32c_table_impl(void){
+    return crc32c_table;
+}
+
+crc32c_fn crc32c_hw_impl(void){
+#ifdef CRC32C_HW
+    if(__builtin_cpu_supports("sse4.2"))
+	return crc32c_hw;
+#endif
+    return NULL;
+}
@@ -0,0 +1,28 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC32C (Castagnoli), the one with a CPU instruction: SSE4.2 crc32
+   when the CPU has it (checked once), a slicing-by-8 table otherwise.
+   Streaming: start from 0 and feed the pieces in order.
+
+	uint32_t crc = 0;
+	crc = crc32c_update(crc, buf, n);
+	...
+ */
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len);
+/* same as feeding len zero bytes, for the holes of a sparse file, in
+   O(log len) without touching any zeros */
+uint32_t crc32c_zeros(uint32_t crc, uint64_t len);
+/* the same in two steps, when several crcs skip the same hole */
+uint32_t crc32c_zeros_op(uint64_t len);
+uint32_t crc32c_zeros_apply(uint32_t crc, uint32_t op);
+
+/* one implementation in particular, for the benchmark. NULL if the
+   CPU can't run the hardware one */
+typedef uint32_t (*crc32c_fn)(uint32_t crc, const void *buf, size_t len);
+crc32c_fn crc32c_table_impl(void);
+crc32c_fn crc32c_hw_impl(void);
+#endif
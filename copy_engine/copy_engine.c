@@ -0,0 +1,324 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "checksum.h"
+#include "copy_engine.h"
+
+#define DEFAULT_BUFSIZE (1 << 20)
+#define KERNEL_CHUNK (1 << 30)      /* per call for copy_file_range/sendfile */
+
+/* the method can't do this pair of fds, try the next one.
+   Anything else (EIO, ENOSPC, ...) is a real error */
+static int unsupported(int err){
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP
+	|| err == EBADF || err == ESPIPE || err == EPERM;
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* each step returns 1 when done, 0 to fall through to the next method,
+   -1 on a real error. *bytes counts what it moved */
+
+static int by_copy_range(int in, int out, off_t *bytes){
+    ssize_t n;
+    while((n = copy_file_range(in, NULL, out, NULL, KERNEL_CHUNK, 0)) > 0)
+	*bytes += n;
+    if(n == 0)
+	return 1;
+    return unsupported(errno) ? 0 : -1;
+}
+
+static int by_sendfile(int in, int out, off_t *bytes){
+    ssize_t n;
+    while((n = sendfile(out, in, NULL, KERNEL_CHUNK)) > 0)
+	*bytes += n;
+    if(n == 0)
+	return 1;
+    return unsupported(errno) ? 0 : -1;
+}
+
+static int is_pipe(int fd){
+    struct stat st;
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+/* with a pipe on either side splice goes straight across, otherwise
+   the data goes in -> our pipe -> out, still never in user space */
+static int by_splice(int in, int out, size_t chunk, off_t *bytes){
+    ssize_t n;
+    if(is_pipe(in) || is_pipe(out)){
+	while((n = splice(in, NULL, out, NULL, chunk, SPLICE_F_MOVE)) > 0)
+	    *bytes += n;
+	if(n == 0)
+	    return 1;
+	return unsupported(errno) ? 0 : -1;
+    }
+
+    int p[2];
+    if(pipe(p) == -1)
+	return 0;
+    fcntl(p[1], F_SETPIPE_SZ, (int)chunk);      /* bigger pipe, fewer calls */
+    int status = 1;
+    while((n = splice(in, NULL, p[1], NULL, chunk, SPLICE_F_MOVE)) > 0){
+	while(n > 0){
+	    ssize_t m = splice(p[0], NULL, out, NULL, n, SPLICE_F_MOVE);
+	    if(m <= 0){
+		/* bytes stuck in our pipe can't be handed to the next
+		   method, so from here on it is a hard error */
+		status = -1;
+		goto done;
+	    }
+	    n -= m;
+	    *bytes += m;
+	}
+    }
+    if(n == -1)
+	status = unsupported(errno) ? 0 : -1;
+done:
+    {
+	int saved = errno;
+	close(p[0]);
+	close(p[1]);
+	errno = saved;
+    }
+    return status;
+}
+
+/* verify mode: what came in, what went out, and holes on both sides */
+static void hash_read(copy_result *res, const char *buf, size_t n){
+    if(res->verified)
+	res->src_crc = crc32c_update(res->src_crc, buf, n);
+}
+
+static void hash_written(copy_result *res, const char *buf, size_t n){
+    if(res->verified)
+	res->dst_crc = crc32c_update(res->dst_crc, buf, n);
+}
+
+static void hash_hole(copy_result *res, off_t n){
+    if(res->verified && n > 0){
+	uint32_t op = crc32c_zeros_op(n);
+	res->src_crc = crc32c_zeros_apply(res->src_crc, op);
+	res->dst_crc = crc32c_zeros_apply(res->dst_crc, op);
+    }
+}
+
+static int by_readwrite(int in, int out, size_t bufsize, copy_result *res){
+    char *buf = malloc(bufsize);
+    ssize_t n;
+    if(buf == NULL)
+	return -1;
+    while((n = read(in, buf, bufsize)) != 0){
+	if(n == -1){
+	    if(errno == EINTR)
+		continue;
+	    break;
+	}
+	hash_read(res, buf, n);
+	for (ssize_t done = 0; done < n; ){
+	    ssize_t m = write(out, buf + done, n - done);
+	    if(m == -1){
+		if(errno == EINTR)
+		    continue;
+		free(buf);
+		return -1;
+	    }
+	    hash_written(res, buf + done, m);
+	    done += m;
+	    res->bytes += m;
+	}
+    }
+    free(buf);
+    return n == 0 ? 1 : -1;
+}
+
+/* one data extent [from, to), same offsets on both sides. Positional
+   so no file offset is involved. */
+static int copy_extent(int in, int out, off_t from, off_t to, char *buf, size_t bufsize,
+		       copy_result *res){
+    off_t in_off = from, out_off = from;
+    while(in_off < to && res->used == COPY_RANGE){
+	ssize_t n = copy_file_range(in, &in_off, out, &out_off, to - in_off, 0);
+	if(n > 0){
+	    res->bytes += n;
+	    continue;
+	}
+	if(n == 0)
+	    return 0;       /* file shrank under us */
+	if(!unsupported(errno))
+	    return -1;
+	res->used = COPY_READWRITE;
+    }
+    while(in_off < to){
+	size_t want = to - in_off < (off_t)bufsize ? (size_t)(to - in_off) : bufsize;
+	ssize_t n = pread(in, buf, want, in_off);
+	if(n <= 0)
+	    return n == 0 ? 0 : -1;
+	hash_read(res, buf, n);
+	for (ssize_t done = 0; done < n; ){
+	    ssize_t m = pwrite(out, buf + done, n - done, in_off + done);
+	    if(m == -1)
+		return -1;
+	    hash_written(res, buf + done, m);
+	    done += m;
+	}
+	in_off += n;
+	res->bytes += n;
+    }
+    return 0;
+}
+
+static int all_zero(const char *buf, size_t n){
+    return n == 0 || (buf[0] == 0 && memcmp(buf, buf + 1, n - 1) == 0);
+}
+
+/* the destination may have had data where the source has a hole */
+static void punch(int out, off_t from, off_t to, int dirty){
+    if(dirty && to > from)
+	fallocate(out, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, from, to - from);
+}
+
+/* filesystem can't SEEK_DATA: read everything, write what isn't zero */
+static int sparse_by_zeroes(int in, int out, off_t size, char *buf, size_t bufsize,
+			    int dirty, copy_result *res){
+    res->used = COPY_READWRITE;
+    for (off_t off = 0; off < size; ){
+	ssize_t n = pread(in, buf, bufsize, off);
+	if(n <= 0)
+	    return n == 0 ? 0 : -1;
+	if(all_zero(buf, n)){
+	    punch(out, off, off + n, dirty);
+	    hash_hole(res, n);
+	    res->skipped += n;
+	}else{
+	    hash_read(res, buf, n);
+	    for (ssize_t done = 0; done < n; ){
+		ssize_t m = pwrite(out, buf + done, n - done, off + done);
+		if(m == -1)
+		    return -1;
+		hash_written(res, buf + done, m);
+		done += m;
+	    }
+	    res->bytes += n;
+	}
+	off += n;
+    }
+    return 0;
+}
+
+/* both ends regular files */
+static int copy_sparse(int in, int out, const struct stat *st, size_t bufsize, copy_result *res){
+    struct stat ost;
+    int status = 0;
+    char *buf = malloc(bufsize);
+    if(buf == NULL || fstat(out, &ost) == -1){
+	free(buf);
+	return -1;
+    }
+    /* the size first, everything we don't write from here on is a hole */
+    int dirty = ost.st_blocks > 0;
+    if(ftruncate(out, st->st_size) == -1){
+	free(buf);
+	return -1;
+    }
+
+    res->used = res->verified ? COPY_READWRITE : COPY_RANGE;
+    off_t off = 0;
+    while(off < st->st_size){
+	off_t data = lseek(in, off, SEEK_DATA);
+	if(data == -1 && errno == ENXIO)
+	    data = st->st_size;     /* only a hole left */
+	else if(data == -1){
+	    status = unsupported(errno) ?
+		sparse_by_zeroes(in, out, st->st_size, buf, bufsize, dirty, res) : -1;
+	    break;
+	}
+	off_t hole = data < st->st_size ? lseek(in, data, SEEK_HOLE) : st->st_size;
+	if(hole == -1){
+	    status = -1;
+	    break;
+	}
+	punch(out, off, data, dirty);
+	hash_hole(res, data - off);
+	res->skipped += data - off;
+	if(copy_extent(in, out, data, hole, buf, bufsize, res) == -1){
+	    status = -1;
+	    break;
+	}
+	off = hole;
+    }
+    free(buf);
+    return status;
+}
+
+int copy_fd(int in, int out, const copy_options *opt, copy_result *res){
+    copy_options defaults = { COPY_AUTO, 0, 0, 0 };
+    copy_result local;
+    struct stat st;
+    int status = 0;
+
+    if(opt == NULL)
+	opt = &defaults;
+    if(res == NULL)
+	res = &local;
+    memset(res, 0, sizeof(*res));
+    size_t bufsize = opt->bufsize ? opt->bufsize : DEFAULT_BUFSIZE;
+    copy_method m = opt->method == COPY_AUTO ? COPY_RANGE : opt->method;
+
+    /* copy_file_range and sendfile read from a file, and a file that
+       reports size 0 (procfs & co) can look finished when it isn't */
+    if(fstat(in, &st) == -1)
+	return -1;
+    if((!S_ISREG(st.st_mode) || st.st_size == 0) && m < COPY_SPLICE)
+	m = COPY_SPLICE;
+
+    if(opt->verify)
+	m = COPY_READWRITE;
+
+    res->verified = opt->verify;
+    double t0 = now();
+    struct stat ost;
+    int sparse = opt->sparse && S_ISREG(st.st_mode)
+	&& fstat(out, &ost) == 0 && S_ISREG(ost.st_mode);
+    if(sparse){
+	status = copy_sparse(in, out, &st, bufsize, res) == 0 ? 1 : -1;
+	m = COPY_READWRITE + 1;
+    }
+    for (; m <= COPY_READWRITE; m++){
+	res->used = m;
+	switch(m){
+	    case COPY_RANGE: status = by_copy_range(in, out, &res->bytes); break;
+	    case COPY_SENDFILE: status = by_sendfile(in, out, &res->bytes); break;
+	    case COPY_SPLICE: status = by_splice(in, out, bufsize, &res->bytes); break;
+	    default: status = by_readwrite(in, out, bufsize, res); break;
+	}
+	if(status != 0)
+	    break;
+    }
+    res->seconds = now() - t0;
+    if(status == 1 && res->verified && res->src_crc != res->dst_crc){
+	errno = EIO;
+	return -1;
+    }
+    return status == 1 ? 0 : -1;
+}
+
+const char *copy_method_name(copy_method m){
+    static const char *names[] = { "auto", "copy_file_range", "sendfile", "splice", "read/write", "io_uring" };
+    return m <= COPY_URING ? names[m] : "?";
+}
+
+double copy_mb_per_s(const copy_result *res){
+    return res->seconds > 0 ? res->bytes / res->seconds / 1e6 : 0;
+}
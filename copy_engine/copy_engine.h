@@ -0,0 +1,61 @@
+#ifndef COPY_ENGINE_H
+#define COPY_ENGINE_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Copies between two file descriptors without dragging every byte
+   through stdio. COPY_AUTO tries, in order:
+
+   1. copy_file_range  the kernel copies (or reflinks) file to file
+   2. sendfile         kernel side, out may be a pipe or socket
+   3. splice           through a pipe, works when one end is a pipe
+   4. read/write       plain loop with a big buffer, always works
+
+   A method that isn't supported for this pair (other filesystem, pipe,
+   old kernel) is dropped and the next one carries on from the current
+   file position, so a partial copy is never redone.
+
+   With sparse set only the data extents of a regular file are copied
+   (found with SEEK_DATA/SEEK_HOLE, or by spotting all zero blocks when
+   the filesystem can't tell), holes stay holes in the destination.
+
+   With verify set the data has to pass through our buffer, so only the
+   read/write path is used (copy_file_range & co never show it to us).
+   CRC32C is computed over what read returned and, separately, over
+   what write accepted, in the same pass. If they differ copy_fd fails
+   with EIO. Holes count as zeros on both sides. Both sums are taken
+   from our buffer, so this checks the copy loop's bookkeeping, not
+   what the destination device ends up holding.
+   Linux only. */
+
+typedef enum{
+    COPY_AUTO,
+    COPY_RANGE,
+    COPY_SENDFILE,
+    COPY_SPLICE,
+    COPY_READWRITE,
+    COPY_URING          /* only set by copy_uring (copy_uring.h) */
+}copy_method;
+
+typedef struct{
+    copy_method method;     /* where to start, COPY_AUTO == COPY_RANGE */
+    size_t bufsize;         /* read/write buffer and splice chunk, 0: 1 MiB */
+    int sparse;
+    int verify;
+}copy_options;
+
+typedef struct{
+    copy_method used;       /* the method that finished the copy */
+    off_t bytes;
+    off_t skipped;          /* sparse mode: hole bytes never read or written */
+    double seconds;
+    int verified;           /* src_crc/dst_crc below are valid */
+    uint32_t src_crc, dst_crc;
+}copy_result;
+
+/* 0 on success, -1 with errno set otherwise. res may be NULL */
+int copy_fd(int in, int out, const copy_options *opt, copy_result *res);
+const char *copy_method_name(copy_method m);
+double copy_mb_per_s(const copy_result *res);
+#endif
@@ -0,0 +1,397 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "copy_engine.h"
+#include "copy_tree.h"
+
+#define DEFAULT_CHUNK ((off_t)64 << 20)
+#define CHUNK_BUF (1 << 20)
+
+/* a file big enough to be split, shared by all of its chunks. Each
+   chunk opens both sides itself, so no fds are held while it waits in
+   the queue. The last chunk to finish sets mode/times and counts the
+   file, unless one of them failed */
+typedef struct{
+    struct stat st;
+    atomic_int pending, failed;
+}big_file;
+
+typedef struct job{
+    struct job *next;
+    char *path;         /* relative to both roots */
+    struct stat st;
+    big_file *big;      /* NULL: whole file */
+    off_t offset, len;
+}job;
+
+typedef struct dir_entry{
+    struct dir_entry *next;
+    char *path;
+    struct stat st;
+}dir_entry;
+
+typedef struct{
+    int srcfd, dstfd;
+    off_t chunk;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    job *head, *tail;
+    int done;           /* walker finished, workers leave when empty */
+    dir_entry *dirs;    /* fixed up at the very end, newest first */
+    atomic_long files, errors;
+    _Atomic off_t bytes;
+    long links;
+}tree_copy;
+
+static void fail(tree_copy *t, const char *what, const char *path){
+    fprintf(stderr, "%s %s: %s\n", what, *path ? path : ".", strerror(errno));
+    atomic_fetch_add(&t->errors, 1);
+}
+
+static void push_job(tree_copy *t, job *j){
+    j->next = NULL;
+    pthread_mutex_lock(&t->lock);
+    if(t->tail)
+	t->tail->next = j;
+    else
+	t->head = j;
+    t->tail = j;
+    pthread_cond_signal(&t->ready);
+    pthread_mutex_unlock(&t->lock);
+}
+
+static job *pop_job(tree_copy *t){
+    pthread_mutex_lock(&t->lock);
+    while(t->head == NULL && !t->done)
+	pthread_cond_wait(&t->ready, &t->lock);
+    job *j = t->head;
+    if(j){
+	t->head = j->next;
+	if(t->head == NULL)
+	    t->tail = NULL;
+    }
+    pthread_mutex_unlock(&t->lock);
+    return j;
+}
+
+static void keep_meta(int fd, const struct stat *st){
+    struct timespec times[2] = { st->st_atim, st->st_mtim };
+    fchmod(fd, st->st_mode & 07777);
+    futimens(fd, times);
+}
+
+static char *join(const char *dir, const char *name){
+    size_t a = strlen(dir), b = strlen(name);
+    char *path = malloc(a + b + 2);
+    if(path == NULL)
+	return NULL;
+    if(a){
+	memcpy(path, dir, a);
+	path[a++] = '/';
+    }
+    memcpy(path + a, name, b + 1);
+    return path;
+}
+
+static const char *at(const char *path){
+    return *path ? path : ".";
+}
+
+static void copy_whole(tree_copy *t, job *j){
+    copy_result r;
+    int in = openat(t->srcfd, j->path, O_RDONLY | O_NOFOLLOW);
+    if(in == -1){
+	fail(t, "open", j->path);
+	return;
+    }
+    int out = openat(t->dstfd, j->path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if(out == -1){
+	fail(t, "create", j->path);
+	close(in);
+	return;
+    }
+    if(copy_fd(in, out, NULL, &r) == -1)
+	fail(t, "copy", j->path);
+    else{
+	keep_meta(out, &j->st);
+	atomic_fetch_add(&t->files, 1);
+	atomic_fetch_add(&t->bytes, r.bytes);
+    }
+    close(out);
+    close(in);
+}
+
+static void copy_chunk(tree_copy *t, job *j){
+    big_file *big = j->big;
+    char *buf = malloc(CHUNK_BUF);
+    off_t off = j->offset, end = j->offset + j->len;
+    int in = openat(t->srcfd, j->path, O_RDONLY | O_NOFOLLOW);
+    int out = in == -1 ? -1 : openat(t->dstfd, j->path, O_WRONLY | O_NOFOLLOW);
+    int err = buf ? 0 : ENOMEM;
+    while(buf && out != -1 && off < end){
+	size_t want = end - off < CHUNK_BUF ? (size_t)(end - off) : CHUNK_BUF;
+	ssize_t n = pread(in, buf, want, off);
+	if(n <= 0){
+	    err = n == 0 ? EIO : errno;     /* 0: the file shrank under us */
+	    break;
+	}
+	for (ssize_t done = 0; done < n; ){
+	    ssize_t m = pwrite(out, buf + done, n - done, off + done);
+	    if(m == -1){
+		err = errno;
+		n = -1;
+		break;
+	    }
+	    done += m;
+	}
+	if(n == -1)
+	    break;
+	off += n;
+    }
+    if(off < end){
+	if(in != -1 && out != -1)
+	    errno = err;
+	fail(t, in == -1 || out == -1 ? "open" : "copy", j->path);
+	atomic_store(&big->failed, 1);
+    }
+    atomic_fetch_add(&t->bytes, off - j->offset);
+    free(buf);
+
+    if(atomic_fetch_sub(&big->pending, 1) == 1){
+	if(!atomic_load(&big->failed)){
+	    keep_meta(out, &big->st);
+	    atomic_fetch_add(&t->files, 1);
+	}
+	free(big);
+    }
+    if(out != -1)
+	close(out);
+    if(in != -1)
+	close(in);
+}
+
+static void *worker(void *arg){
+    tree_copy *t = arg;
+    job *j;
+    while((j = pop_job(t)) != NULL){
+	if(j->big)
+	    copy_chunk(t, j);
+	else
+	    copy_whole(t, j);
+	free(j->path);
+	free(j);
+    }
+    return NULL;
+}
+
+/* a big file is created and sized here, so the chunks can go in
+   any order; it is closed again until its chunks come up */
+static void queue_file(tree_copy *t, const char *path, const struct stat *st){
+    if(st->st_size <= t->chunk){
+	job *j = calloc(1, sizeof(job));
+	if(j == NULL || (j->path = strdup(path)) == NULL){
+	    free(j);
+	    errno = ENOMEM;
+	    fail(t, "queue", path);
+	    return;
+	}
+	j->st = *st;
+	push_job(t, j);
+	return;
+    }
+
+    int out = openat(t->dstfd, path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if(out == -1 || ftruncate(out, st->st_size) == -1){
+	fail(t, "create", path);
+	if(out != -1)
+	    close(out);
+	return;
+    }
+    close(out);
+    big_file *big = malloc(sizeof(big_file));
+    if(big == NULL){
+	errno = ENOMEM;
+	fail(t, "queue", path);
+	return;
+    }
+    big->st = *st;
+    off_t chunks = (st->st_size + t->chunk - 1) / t->chunk;
+    atomic_init(&big->pending, (int)chunks);
+    atomic_init(&big->failed, 0);
+    for (off_t c = 0; c < chunks; c++){
+	job *j = calloc(1, sizeof(job));
+	if(j == NULL || (j->path = strdup(path)) == NULL){
+	    /* the chunks not queued are done, and failed */
+	    free(j);
+	    errno = ENOMEM;
+	    fail(t, "queue", path);
+	    atomic_store(&big->failed, 1);
+	    if(atomic_fetch_sub(&big->pending, (int)(chunks - c)) == chunks - c)
+		free(big);
+	    return;
+	}
+	j->big = big;
+	j->offset = c * t->chunk;
+	j->len = c == chunks - 1 ? st->st_size - j->offset : t->chunk;
+	push_job(t, j);
+    }
+}
+
+static void walk(tree_copy *t, int dirfd, const char *path){
+    DIR *dir = fdopendir(dirfd);
+    struct dirent *e;
+    if(dir == NULL){
+	fail(t, "opendir", path);
+	close(dirfd);
+	return;
+    }
+    while((e = readdir(dir)) != NULL){
+	struct stat st;
+	dir_entry *d = NULL;
+	if(strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+	    continue;
+	char *sub = join(path, e->d_name);
+	if(sub == NULL){
+	    errno = ENOMEM;
+	    fail(t, "queue", e->d_name);
+	    continue;
+	}
+	if(fstatat(dirfd, e->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1)
+	    fail(t, "stat", sub);
+	else if(S_ISDIR(st.st_mode)){
+	    if(mkdirat(t->dstfd, sub, 0700) == -1 && errno != EEXIST)
+		fail(t, "mkdir", sub);
+	    else if((d = malloc(sizeof(dir_entry))) == NULL || (d->path = strdup(sub)) == NULL){
+		free(d);
+		errno = ENOMEM;
+		fail(t, "queue", sub);
+	    }else{
+		d->st = st;
+		d->next = t->dirs;
+		t->dirs = d;
+		int fd = openat(dirfd, e->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+		if(fd == -1)
+		    fail(t, "open", sub);
+		else
+		    walk(t, fd, sub);
+	    }
+	}else if(S_ISREG(st.st_mode))
+	    queue_file(t, sub, &st);
+	else if(S_ISLNK(st.st_mode)){
+	    char target[4096];
+	    ssize_t n = readlinkat(dirfd, e->d_name, target, sizeof(target) - 1);
+	    if(n == -1)
+		fail(t, "readlink", sub);
+	    else{
+		target[n] = '\0';
+		if(symlinkat(target, t->dstfd, sub) == -1)
+		    fail(t, "symlink", sub);
+		else{
+		    struct timespec times[2] = { st.st_atim, st.st_mtim };
+		    utimensat(t->dstfd, sub, times, AT_SYMLINK_NOFOLLOW);
+		    t->links++;
+		}
+	    }
+	}else
+	    fprintf(stderr, "skipping %s: not a file, directory or symlink\n", sub);
+	free(sub);
+    }
+    closedir(dir);
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int copy_tree(const char *src, const char *dst, const tree_options *opt, tree_result *res){
+    tree_options defaults = { 0, 0 };
+    tree_result local;
+    struct stat root;
+    tree_copy t;
+
+    if(opt == NULL)
+	opt = &defaults;
+    if(res == NULL)
+	res = &local;
+    memset(res, 0, sizeof(*res));
+    int nthreads = opt->nthreads > 0 ? opt->nthreads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    memset(&t, 0, sizeof(t));
+    t.chunk = opt->chunk > 0 ? opt->chunk : DEFAULT_CHUNK;
+
+    double t0 = now();
+    if((t.srcfd = open(src, O_RDONLY | O_DIRECTORY)) == -1)
+	return -1;
+    pthread_t *threads = malloc(nthreads * sizeof(pthread_t));
+    if(threads == NULL || fstat(t.srcfd, &root) == -1
+       || (mkdir(dst, 0700) == -1 && errno != EEXIST)
+       || (t.dstfd = open(dst, O_RDONLY | O_DIRECTORY)) == -1){
+	int saved = threads ? errno : ENOMEM;
+	free(threads);
+	close(t.srcfd);
+	errno = saved;
+	return -1;
+    }
+    pthread_mutex_init(&t.lock, NULL);
+    pthread_cond_init(&t.ready, NULL);
+
+    /* carry on with however many workers could be started */
+    int started = 0;
+    while(started < nthreads && pthread_create(&threads[started], NULL, worker, &t) == 0)
+	started++;
+    if(started == 0){
+	free(threads);
+	pthread_mutex_destroy(&t.lock);
+	pthread_cond_destroy(&t.ready);
+	close(t.dstfd);
+	close(t.srcfd);
+	errno = EAGAIN;
+	return -1;
+    }
+
+    walk(&t, dup(t.srcfd), "");
+
+    pthread_mutex_lock(&t.lock);
+    t.done = 1;
+    pthread_cond_broadcast(&t.ready);
+    pthread_mutex_unlock(&t.lock);
+    for (int i = 0; i < started; i++)
+	pthread_join(threads[i], NULL);
+    free(threads);
+
+    /* deepest first (the list is newest first), then the root */
+    res->dirs = 0;
+    while(t.dirs){
+	dir_entry *d = t.dirs;
+	struct timespec times[2] = { d->st.st_atim, d->st.st_mtim };
+	fchmodat(t.dstfd, at(d->path), d->st.st_mode & 07777, 0);
+	utimensat(t.dstfd, at(d->path), times, AT_SYMLINK_NOFOLLOW);
+	t.dirs = d->next;
+	free(d->path);
+	free(d);
+	res->dirs++;
+    }
+    keep_meta(t.dstfd, &root);
+
+    pthread_mutex_destroy(&t.lock);
+    pthread_cond_destroy(&t.ready);
+    close(t.dstfd);
+    close(t.srcfd);
+
+    res->files = atomic_load(&t.files);
+    res->errors = atomic_load(&t.errors);
+    res->links = t.links;
+    res->bytes = atomic_load(&t.bytes);
+    res->seconds = now() - t0;
+    return res->errors ? -1 : 0;
+}
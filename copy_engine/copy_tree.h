@@ -0,0 +1,29 @@
+#ifndef COPY_TREE_H
+#define COPY_TREE_H
+
+#include <sys/types.h>
+
+/* Recursive copy of a directory tree with a pool of worker threads.
+   One thread walks the source (openat/fdopendir), creates directories
+   and symlinks right away and queues the files. Workers copy the files
+   with copy_fd; a file bigger than chunk is cut into chunk sized pieces
+   that different workers copy with pread/pwrite at their own offsets.
+   Modes and timestamps of files and directories are kept (directories
+   last, creating files inside them would bump their mtime again). */
+
+typedef struct{
+    int nthreads;       /* 0: one per online CPU */
+    off_t chunk;        /* 0: 64 MiB */
+}tree_options;
+
+typedef struct{
+    long files, dirs, links, errors;
+    off_t bytes;
+    double seconds;
+}tree_result;
+
+/* dst must not exist yet or be an empty directory. Errors on single
+   entries are reported on stderr and counted, the rest still gets
+   copied; returns -1 if there was any */
+int copy_tree(const char *src, const char *dst, const tree_options *opt, tree_result *res);
+#endif
@@ -0,0 +1,102 @@
+/* copy_tree on synthetic trees: lots of small files, then a few huge
+   ones, with 1, 2, 4 ... threads up to every core.
+
+	./copy_tree_bench scratch_dir [small_files] [huge_mb]
+
+   gcc -O2 -pthread copy_tree_bench.c copy_tree.c copy_engine.c checksum.c -o copy_tree_bench */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "copy_tree.h"
+
+static void make_file(const char *path, size_t size, char *buf, size_t bufsize)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd == -1){
+	perror(path);
+	exit(EXIT_FAILURE);
+    }
+    for (size_t done = 0; done < size; ){
+	size_t n = size - done < bufsize ? size - done : bufsize;
+	if(write(fd, buf, n) != (ssize_t)n){
+	    perror(path);
+	    exit(EXIT_FAILURE);
+	}
+	done += n;
+    }
+    close(fd);
+}
+
+/* small: 100 dirs of 4 KiB files, huge: 4 files of huge_mb each */
+static void make_tree(const char *root, int small_files, int huge_mb)
+{
+    char path[4096];
+    size_t bufsize = 1 << 20;
+    char *buf = malloc(bufsize);
+    for (size_t i = 0; i < bufsize; i++)
+	buf[i] = rand();
+
+    mkdir(root, 0755);
+    for (int d = 0; d < 100 && small_files; d++){
+	snprintf(path, sizeof(path), "%s/d%02d", root, d);
+	mkdir(path, 0755);
+	for (int f = d; f < small_files; f += 100){
+	    snprintf(path, sizeof(path), "%s/d%02d/f%06d", root, d, f);
+	    make_file(path, 4096, buf, bufsize);
+	}
+    }
+    for (int f = 0; f < 4 && huge_mb; f++){
+	snprintf(path, sizeof(path), "%s/huge%d", root, f);
+	make_file(path, (size_t)huge_mb << 20, buf, bufsize);
+    }
+    free(buf);
+}
+
+static void run(const char *name, const char *src, const char *scratch)
+{
+    char dst[4096], cmd[8300];
+    int cores = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%s\n%8s %10s %10s %12s\n", name, "threads", "seconds", "MB/s", "files/s");
+    for (int t = 1; ; t = t * 2 > cores && t != cores ? cores : t * 2){
+	tree_options opt = { t, 0 };
+	tree_result res;
+	snprintf(dst, sizeof(dst), "%s/copy", scratch);
+	snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dst);
+	system(cmd);
+	sync();
+	if(copy_tree(src, dst, &opt, &res) == -1)
+	    fprintf(stderr, "copy had %ld errors\n", res.errors);
+	printf("%8d %10.3f %10.1f %12.0f\n", t, res.seconds,
+	       res.bytes / res.seconds / 1e6, res.files / res.seconds);
+	if(t == cores)
+	    break;
+    }
+    system(cmd);
+}
+
+int main(int argc, char *argv[])
+{
+    char small[4096], huge[4096], cmd[8300];
+    if(argc < 2){
+	fprintf(stderr, "Usage: %s scratch_dir [small_files] [huge_mb]\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    int small_files = argc > 2 ? atoi(argv[2]) : 50000;
+    int huge_mb = argc > 3 ? atoi(argv[3]) : 512;
+
+    mkdir(argv[1], 0755);
+    snprintf(small, sizeof(small), "%s/small", argv[1]);
+    snprintf(huge, sizeof(huge), "%s/huge", argv[1]);
+    make_tree(small, small_files, 0);
+    make_tree(huge, 0, huge_mb);
+
+    run("many small files", small, argv[1]);
+    run("few huge files", huge, argv[1]);
+
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s' '%s'", small, huge);
+    system(cmd);
+    return 0;
+}
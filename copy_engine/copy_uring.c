@@ -0,0 +1,332 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include "copy_uring.h"
+
+#define DEFAULT_DEPTH 16
+#define DEFAULT_BUFSIZE (1 << 20)
+#define DIRECT_ALIGN 4096
+
+typedef struct{
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map, *cq_map;
+    size_t sq_size, cq_size, sqes_size;
+    unsigned sq_entries;
+    unsigned queued;    /* sqes filled in but not yet submitted */
+}uring;
+
+enum { IDLE, READING, WRITING };
+
+typedef struct{
+    int state;
+    off_t off;
+    size_t want, got, wlen, written;
+}slot;
+
+static int uring_setup(uring *r, unsigned entries){
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(r, 0, sizeof(*r));
+    r->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if(r->fd == -1)
+	return -1;
+
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sq_entries = p.sq_entries;
+    r->sq_map = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		     r->fd, IORING_OFF_SQ_RING);
+    r->cq_map = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		     r->fd, IORING_OFF_CQ_RING);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		   r->fd, IORING_OFF_SQES);
+    if(r->sq_map == MAP_FAILED || r->cq_map == MAP_FAILED || r->sqes == MAP_FAILED){
+	close(r->fd);
+	return -1;
+    }
+
+    char *sq = r->sq_map, *cq = r->cq_map;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+static void uring_close(uring *r){
+    munmap(r->sqes, r->sqes_size);
+    munmap(r->cq_map, r->cq_size);
+    munmap(r->sq_map, r->sq_size);
+    close(r->fd);
+}
+
+/* queue one fixed buffer read or write, user_data is the slot number */
+static void uring_queue(uring *r, int op, int fd, unsigned index, void *buf, size_t len, off_t off){
+    unsigned tail = *r->sq_tail;
+    unsigned at = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[at];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = len;
+    sqe->off = off;
+    sqe->buf_index = index;
+    sqe->user_data = index;
+    r->sq_array[at] = at;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->queued++;
+}
+
+#define CANCEL_TAG (1ULL << 32)    /* user_data of a cancel, not a slot */
+
+/* ask the kernel to cancel the request of slot index */
+static void uring_queue_cancel(uring *r, unsigned index){
+    unsigned tail = *r->sq_tail;
+    unsigned at = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[at];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = index;
+    sqe->user_data = CANCEL_TAG | index;
+    r->sq_array[at] = at;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->queued++;
+}
+
+/* submit what is queued and wait for at least one completion. The
+   kernel may take only part of the batch, the rest stays in the ring
+   and goes with the next call */
+static int uring_submit_wait(uring *r){
+    long n;
+    while((n = syscall(__NR_io_uring_enter, r->fd, r->queued, 1, IORING_ENTER_GETEVENTS, NULL, 0)) == -1){
+	if(errno != EINTR)
+	    return -1;
+    }
+    r->queued -= n;
+    return 0;
+}
+
+/* after a failed wait: cancel whatever is still in flight and reap it
+   all, so the kernel is done with the buffers. -1 if even that fails */
+static int uring_cancel_all(uring *r, const slot *slots, unsigned depth, unsigned inflight){
+    unsigned room = r->sq_entries - (*r->sq_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE));
+    for (unsigned i = 0; i < depth && room > 0; i++)
+	if(slots[i].state != IDLE){
+	    uring_queue_cancel(r, i);
+	    room--;
+	}
+    while(inflight > 0){
+	if(uring_submit_wait(r) == -1)
+	    return -1;
+	unsigned head = *r->cq_head;
+	for (; head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE); head++)
+	    if(!(r->cqes[head & *r->cq_mask].user_data & CANCEL_TAG))
+		inflight--;
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int copy_uring(int in, int out, const uring_options *opt, copy_result *res){
+    uring_options defaults = { 0, 0 };
+    copy_result local;
+    struct stat st;
+    uring r;
+
+    if(opt == NULL)
+	opt = &defaults;
+    if(res == NULL)
+	res = &local;
+    memset(res, 0, sizeof(*res));
+    struct stat ost;
+    if(fstat(in, &st) == -1 || fstat(out, &ost) == -1)
+	return -1;
+    /* writes land by offset and may finish in any order, a pipe or
+       socket would get the pieces shuffled */
+    if(!S_ISREG(st.st_mode) || !S_ISREG(ost.st_mode))
+	return copy_fd(in, out, NULL, res);
+
+    unsigned depth = opt->depth ? opt->depth : DEFAULT_DEPTH;
+    size_t bufsize = opt->bufsize ? opt->bufsize : DEFAULT_BUFSIZE;
+    int direct = ((fcntl(in, F_GETFL) | fcntl(out, F_GETFL)) & O_DIRECT) != 0;
+    off_t size = st.st_size;
+
+    char *bufs;
+    if(posix_memalign((void **)&bufs, DIRECT_ALIGN, depth * bufsize) != 0)
+	return -1;
+    slot *slots = calloc(depth, sizeof(slot));
+    struct iovec *iov = malloc(depth * sizeof(struct iovec));
+    if(slots == NULL || iov == NULL || uring_setup(&r, depth) == -1){
+	free(bufs);
+	free(slots);
+	free(iov);
+	return -1;
+    }
+    for (unsigned i = 0; i < depth; i++){
+	iov[i].iov_base = bufs + i * bufsize;
+	iov[i].iov_len = bufsize;
+    }
+    int fixed = syscall(__NR_io_uring_register, r.fd, IORING_REGISTER_BUFFERS, iov, depth) == 0;
+    int op_read = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    int op_write = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+
+    res->used = COPY_URING;
+    double t0 = now();
+    off_t next = 0;
+    unsigned inflight = 0;
+    int err = 0;
+
+    /* O_DIRECT reads must be whole blocks too, past EOF they come back short */
+#define READ_SLOT(i, from, len) do{                                              \
+	slots[i].state = READING;                                               \
+	slots[i].off = (from);                                                  \
+	slots[i].want = (len);                                                  \
+	size_t ask = direct ? (slots[i].want + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN \
+			    : slots[i].want;                                    \
+	uring_queue(&r, op_read, in, i, bufs + (i) * bufsize, ask, slots[i].off); \
+	inflight++;                                                             \
+    }while(0)
+
+    for (unsigned i = 0; i < depth && next < size; i++){
+	size_t len = size - next < (off_t)bufsize ? (size_t)(size - next) : bufsize;
+	READ_SLOT(i, next, len);
+	next += len;
+    }
+
+    while(inflight > 0){
+	if(uring_submit_wait(&r) == -1){
+	    err = errno;
+	    break;
+	}
+	unsigned head = *r.cq_head;
+	while(head != __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE)){
+	    struct io_uring_cqe *cqe = &r.cqes[head & *r.cq_mask];
+	    unsigned i = cqe->user_data;
+	    int result = cqe->res;
+	    slot *s = &slots[i];
+	    char *buf = bufs + i * bufsize;
+	    head++;
+	    inflight--;
+
+	    if(result == -EINTR || result == -EAGAIN){
+		/* just do it again */
+		if(s->state == READING)
+		    READ_SLOT(i, s->off, s->want);
+		else{
+		    uring_queue(&r, op_write, out, i, buf + s->written,
+				s->wlen - s->written, s->off + s->written);
+		    inflight++;
+		}
+		continue;
+	    }
+	    if(result < 0 || err){
+		if(result < 0 && !err)
+		    err = -result;
+		s->state = IDLE;    /* let the rest drain */
+		continue;
+	    }
+
+	    if(s->state == READING){
+		if(result == 0){
+		    s->state = IDLE;        /* file got shorter */
+		    continue;
+		}
+		s->got = (size_t)result < s->want ? (size_t)result : s->want;
+		/* O_DIRECT: a short read keeps only its whole blocks, so the
+		   rest is read again from an aligned offset */
+		if(direct && s->got < s->want){
+		    s->got -= s->got % DIRECT_ALIGN;
+		    if(s->got == 0){
+			READ_SLOT(i, s->off, s->want);
+			continue;
+		    }
+		}
+		s->wlen = s->got;
+		s->written = 0;
+		/* O_DIRECT: the tail goes out as a whole block */
+		if(direct && s->wlen % DIRECT_ALIGN){
+		    size_t padded = (s->wlen + DIRECT_ALIGN - 1) / DIRECT_ALIGN * DIRECT_ALIGN;
+		    memset(buf + s->wlen, 0, padded - s->wlen);
+		    s->wlen = padded;
+		}
+		s->state = WRITING;
+		uring_queue(&r, op_write, out, i, buf, s->wlen, s->off);
+		inflight++;
+	    }else{
+		/* O_DIRECT: a short write is redone from its last whole
+		   block, writing the same bytes twice is harmless */
+		size_t was = s->written;
+		s->written += result;
+		if(direct && s->written < s->wlen)
+		    s->written -= s->written % DIRECT_ALIGN;
+		if(s->written == was){
+		    err = EIO;      /* no progress at all */
+		    s->state = IDLE;
+		    continue;
+		}
+		if(s->written < s->wlen){
+		    uring_queue(&r, op_write, out, i, buf + s->written,
+				s->wlen - s->written, s->off + s->written);
+		    inflight++;
+		    continue;
+		}
+		res->bytes += s->got;
+		if(s->got < s->want)
+		    READ_SLOT(i, s->off + s->got, s->want - s->got);
+		else if(next < size){
+		    size_t len = size - next < (off_t)bufsize ? (size_t)(size - next) : bufsize;
+		    READ_SLOT(i, next, len);
+		    next += len;
+		}else
+		    s->state = IDLE;
+	    }
+	}
+	__atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+    }
+#undef READ_SLOT
+
+    /* the kernel may still read or write bufs until every request is
+       reaped; if that can't be done they are leaked, not freed */
+    int leak = inflight > 0 && uring_cancel_all(&r, slots, depth, inflight) == -1;
+    if(!err && direct && ftruncate(out, size) == -1)
+	err = errno;
+    res->seconds = now() - t0;
+    uring_close(&r);
+    free(iov);
+    free(slots);
+    if(!leak)
+	free(bufs);
+    if(err){
+	errno = err;
+	return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef COPY_URING_H
+#define COPY_URING_H
+
+#include <stddef.h>
+#include "copy_engine.h"
+
+/* io_uring copy backend, raw syscalls, no liburing needed.
+   depth buffers (registered with the kernel as fixed buffers) go round
+   in a pipeline: each one is read into, written out, then read into
+   again from the next free offset, so there are always up to depth
+   reads and writes in flight and a fast device's queue stays full.
+
+   Both fds may be O_DIRECT (see fcopy -d): buffers are page aligned,
+   bufsize should be a multiple of the block size, and the tail of the
+   file is written padded to a full block and trimmed with ftruncate.
+   The input has to be a regular file, anything else goes to copy_fd. */
+
+typedef struct{
+    unsigned depth;     /* buffers in flight, 0: 16 */
+    size_t bufsize;     /* per buffer, 0: 1 MiB */
+}uring_options;
+
+/* 0 on success, -1 with errno set. res->used is COPY_URING unless it
+   had to hand over to copy_fd */
+int copy_uring(int in, int out, const uring_options *opt, copy_result *res);
+#endif
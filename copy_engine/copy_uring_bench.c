@@ -0,0 +1,113 @@
+/* io_uring against the byte at a time loop from copying.c and a plain
+   read/write loop: MB/s and CPU seconds per GB (user + system, io_uring
+   worker threads included). Buffered and O_DIRECT, several depths.
+
+	./copy_uring_bench source destination [size_mb]
+
+   source is created with size_mb of random data if it doesn't exist.
+   Put source and destination on the device under test; buffered runs
+   after the first one mostly read from the page cache.
+
+   gcc -O2 copy_uring_bench.c copy_uring.c copy_engine.c checksum.c -o copy_uring_bench */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "copy_engine.h"
+#include "copy_uring.h"
+
+enum { BYTE_LOOP, READ_WRITE, URING };
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpu_seconds(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6
+	 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+/* the loop from copying.c */
+static int byte_loop(int in, int out, copy_result *res)
+{
+    FILE *source_fp = fdopen(dup(in), "rb"), *dest_fp = fdopen(dup(out), "wb");
+    int ch;
+    res->bytes = 0;
+    while((ch = getc(source_fp)) != EOF){
+	putc(ch, dest_fp);
+	res->bytes++;
+    }
+    fclose(dest_fp);
+    fclose(source_fp);
+    return 0;
+}
+
+static void run(const char *name, int how, unsigned depth, int direct,
+		const char *source, const char *dest)
+{
+    copy_options rw = { COPY_READWRITE, 0, 0, 0 };
+    uring_options uo = { depth, 0 };
+    copy_result res;
+    int in = open(source, O_RDONLY | direct);
+    int out = open(dest, O_WRONLY | O_CREAT | O_TRUNC | direct, 0644);
+    if(in == -1 || out == -1){
+	perror(direct ? "open O_DIRECT" : "open");
+	exit(EXIT_FAILURE);
+    }
+
+    double cpu = cpu_seconds(), t0 = now();
+    int status = how == BYTE_LOOP ? byte_loop(in, out, &res)
+	       : how == READ_WRITE ? copy_fd(in, out, &rw, &res)
+	       : copy_uring(in, out, &uo, &res);
+    if(!direct)
+	fsync(out);     /* otherwise we only measure the page cache */
+    double elapsed = now() - t0;
+    cpu = cpu_seconds() - cpu;
+    close(out);
+    close(in);
+    if(status == -1){
+	perror(name);
+	return;
+    }
+    double gb = res.bytes / 1e9;
+    printf("%-22s %5u %10.1f %12.3f\n", name, depth, res.bytes / elapsed / 1e6, cpu / gb);
+}
+
+int main(int argc, char *argv[])
+{
+    struct stat st;
+    if(argc < 3){
+	fprintf(stderr, "Usage: %s source destination [size_mb]\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    if(stat(argv[1], &st) == -1){
+	long mb = argc > 3 ? atol(argv[3]) : 1024;
+	FILE *fp = fopen(argv[1], "wb");
+	for (long i = 0; fp && i < mb << 20; i++)
+	    putc(rand(), fp);
+	if(fp == NULL || fclose(fp) == EOF){
+	    perror(argv[1]);
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+    printf("%-22s %5s %10s %12s\n", "", "depth", "MB/s", "cpu s/GB");
+    run("byte loop (copying.c)", BYTE_LOOP, 0, 0, argv[1], argv[2]);
+    run("read/write 1 MiB", READ_WRITE, 0, 0, argv[1], argv[2]);
+    unsigned depths[] = { 1, 4, 16, 64 };
+    for (int d = 0; d < 4; d++)
+	run("io_uring", URING, depths[d], 0, argv[1], argv[2]);
+    for (int d = 0; d < 4; d++)
+	run("io_uring O_DIRECT", URING, depths[d], O_DIRECT, argv[1], argv[2]);
+    return 0;
+}
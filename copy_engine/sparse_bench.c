@@ -0,0 +1,160 @@
+/* checks that copy_fd with sparse set (fcopy -s) keeps the holes:
+   builds a file of data extents and holes, copies it a few ways and
+   compares contents and blocks used. Exits 1 if the destination
+   differs, or uses more than SLACK bytes more than the source.
+
+	./sparse_bench [directory]
+
+   The files go in directory (default .), which should be on the
+   filesystem under test; one without holes makes the source dense
+   and the check trivial, that is said in the output.
+
+   gcc -O2 sparse_bench.c copy_engine.c checksum.c -o sparse_bench */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "copy_engine.h"
+
+#define MB ((off_t)1 << 20)
+#define SLACK (128 << 10)       /* filesystem rounding, in bytes */
+
+/* data at these offsets, holes in between and after the last one */
+static const struct{ off_t at, len; } extents[] = {
+    { 0, 1 * MB }, { 21 * MB, 4096 }, { 71 * MB + 12345, 3 * MB }, { 90 * MB, 64 << 10 },
+};
+#define FILE_SIZE (100 * MB)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void die(const char *what)
+{
+    perror(what);
+    exit(EXIT_FAILURE);
+}
+
+static void make_source(const char *path)
+{
+    char *buf = malloc(3 * MB);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(buf == NULL || fd == -1)
+	die(path);
+    for (size_t e = 0; e < sizeof(extents) / sizeof(extents[0]); e++){
+	for (off_t i = 0; i < extents[e].len; i++)
+	    buf[i] = 1 + (e * 7 + i) % 251;     /* never 0 */
+	if(pwrite(fd, buf, extents[e].len, extents[e].at) != extents[e].len)
+	    die(path);
+    }
+    if(ftruncate(fd, FILE_SIZE) == -1)
+	die(path);
+    close(fd);
+    free(buf);
+}
+
+/* a destination that already has data everywhere, holes must be punched */
+static void make_dirty(const char *path)
+{
+    char *buf = malloc(MB);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(buf == NULL || fd == -1)
+	die(path);
+    memset(buf, 0xab, MB);
+    for (off_t off = 0; off < FILE_SIZE; off += MB)
+	if(write(fd, buf, MB) != MB)
+	    die(path);
+    close(fd);
+    free(buf);
+}
+
+static int same_contents(const char *a, const char *b)
+{
+    char *x = malloc(MB), *y = malloc(MB);
+    int fa = open(a, O_RDONLY), fb = open(b, O_RDONLY), same = 1;
+    if(x == NULL || y == NULL || fa == -1 || fb == -1)
+	die("compare");
+    for (;;){
+	ssize_t n = read(fa, x, MB), m = read(fb, y, MB);
+	if(n != m || n == -1 || memcmp(x, y, n) != 0){
+	    same = 0;
+	    break;
+	}
+	if(n == 0)
+	    break;
+    }
+    close(fa);
+    close(fb);
+    free(x);
+    free(y);
+    return same;
+}
+
+static off_t allocated(const char *path)
+{
+    struct stat st;
+    if(stat(path, &st) == -1)
+	die(path);
+    return (off_t)st.st_blocks * 512;
+}
+
+/* 0 if the copy is right and no bigger than the source */
+static int run(const char *name, const char *source, const char *dest, int sparse, int verify,
+	       int dirty)
+{
+    copy_options opt = { COPY_AUTO, 0, sparse, verify };
+    copy_result res;
+    if(dirty)
+	make_dirty(dest);
+    int in = open(source, O_RDONLY);
+    int out = open(dest, O_WRONLY | O_CREAT | (dirty ? 0 : O_TRUNC), 0644);
+    if(in == -1 || out == -1)
+	die(name);
+    double t0 = now();
+    int status = copy_fd(in, out, &opt, &res);
+    double elapsed = now() - t0;
+    close(out);
+    close(in);
+    if(status == -1){
+	perror(name);
+	return 1;
+    }
+
+    off_t src = allocated(source), dst = allocated(dest);
+    int same = same_contents(source, dest);
+    int bad = !same || (sparse && dst > src + SLACK);
+    printf("%-24s %12lld %12lld %12lld %8.1f  %s\n", name, (long long)res.skipped,
+	   (long long)src, (long long)dst, elapsed * 1e3,
+	   !same ? "CONTENTS DIFFER" : bad ? "TOO MANY BLOCKS" : "ok");
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dir = argc > 1 ? argv[1] : ".";
+    char source[4096], dest[4096];
+    snprintf(source, sizeof(source), "%s/sparse_bench.src", dir);
+    snprintf(dest, sizeof(dest), "%s/sparse_bench.dst", dir);
+
+    make_source(source);
+    if(allocated(source) >= FILE_SIZE)
+	printf("(%s doesn't keep holes, the source is dense)\n", dir);
+
+    int failed = 0;
+    printf("%-24s %12s %12s %12s %8s\n", "", "skipped", "src alloc", "dst alloc", "ms");
+    failed |= run("sparse", source, dest, 1, 0, 0);
+    failed |= run("sparse, verify", source, dest, 1, 1, 0);
+    failed |= run("sparse, dirty dest", source, dest, 1, 0, 1);
+    run("dense (no -s)", source, dest, 0, 0, 0);
+
+    unlink(dest);
+    unlink(source);
+    return failed;
+}
@@ -1,33 +1,159 @@
-/* copies a file */
+/* copies a file
+   through copy_engine/: copy_file_range, sendfile, splice or a plain
+   read/write loop, whichever works first. copying.c still has the old
+   byte at a time loop.
+
+	fcopy [-s] [-V] [-m auto|range|sendfile|splice|rw] source destination
+	fcopy -r [-j threads] source_dir destination_dir
+	fcopy -u [-q depth] [-d] source destination
+
+   destination "-" is stdout (which may well be a pipe).
+   -s copies only the data of a sparse file and prints how many blocks
+   source and destination really use.
+   -r copies a whole tree with -j worker threads (default one per CPU).
+   -u uses io_uring with -q buffers in flight, -d opens both files O_DIRECT.
+   -V (--verify) checksums with CRC32C on the way through and fails if
+   what was written isn't what was read. Forces the read/write path.
+   Both sums come from the same buffer, so this catches bytes lost,
+   repeated or reordered between read and write, not data corrupted
+   after write took it (page cache, disk); for that, read the copy back
+   and compare.
+   Options only go with their own form above, anything else is a usage
+   error.
+
+   gcc -O2 -pthread fcopy.c copy_engine/copy_engine.c copy_engine/copy_tree.c \
+       copy_engine/copy_uring.c copy_engine/checksum.c -o fcopy */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "copy_engine/copy_engine.h"
+#include "copy_engine/copy_tree.h"
+#include "copy_engine/copy_uring.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-s] [-V] [-m auto|range|sendfile|splice|rw] source destination\n"
+	    "       %s -r [-j threads] source_dir destination_dir\n"
+	    "       %s -u [-q depth] [-d] source destination\n", prog, prog, prog);
+    exit(EXIT_FAILURE);
+}
+
+static copy_method parse_method(const char *name, const char *prog)
+{
+    const char *names[] = { "auto", "range", "sendfile", "splice", "rw" };
+    for (int m = COPY_AUTO; m <= COPY_READWRITE; m++)
+	if(strcmp(name, names[m]) == 0)
+	    return m;
+    usage(prog);
+    return COPY_AUTO;
+}
+
+static void report_blocks(const char *name, int fd)
+{
+    struct stat st;
+    if(fstat(fd, &st) == 0)
+	fprintf(stderr, "%-12s size %12lld  allocated %12lld\n", name,
+		(long long)st.st_size, (long long)st.st_blocks * 512);
+}
 
 int main(int argc, char *argv[])
 {
-    FILE *source_fp, *dest_fp;
-    int ch;
-    if(argc != 3)
-    {
-	fprintf(stderr, "Usage: %s source destination\n", argv[0]);
-	exit(EXIT_FAILURE);
+    copy_options opt = { COPY_AUTO, 0, 0, 0 };
+    copy_result res;
+    tree_options tree = { 0, 0 };
+    uring_options uring = { 0, 0 };
+    int source_fd, dest_fd, c, recursive = 0, use_uring = 0, direct = 0;
+    int method_set = 0, threads_set = 0, depth_set = 0;
+    struct option long_options[] = {
+	{"verify", no_argument, NULL, 'V'},
+	{NULL, 0, NULL, 0}
+    };
+
+    while((c = getopt_long(argc, argv, "sm:rj:uq:dV", long_options, NULL)) != -1){
+	if(c == 'm'){
+	    opt.method = parse_method(optarg, argv[0]);
+	    method_set = 1;
+	}
+	else if(c == 's')
+	    opt.sparse = 1;
+	else if(c == 'r')
+	    recursive = 1;
+	else if(c == 'j'){
+	    tree.nthreads = atoi(optarg);
+	    threads_set = 1;
+	}
+	else if(c == 'u')
+	    use_uring = 1;
+	else if(c == 'q'){
+	    uring.depth = atoi(optarg);
+	    depth_set = 1;
+	}
+	else if(c == 'd')
+	    direct = O_DIRECT;
+	else if(c == 'V')
+	    opt.verify = 1;
+	else
+	    usage(argv[0]);
     }
+    /* each option only goes with its own form of the command line, -d
+       in particular: copy_fd can't do O_DIRECT and fails half way */
+    int plain_only = opt.sparse || opt.verify || method_set;
+    if(argc - optind != 2 || (recursive && use_uring)
+       || ((recursive || use_uring) && plain_only)
+       || (threads_set && !recursive) || ((depth_set || direct) && !use_uring))
+	usage(argv[0]);
+    const char *source = argv[optind], *dest = argv[optind + 1];
 
-    if( (source_fp = fopen(argv[1], "rb")) == NULL){
-	fprintf(stderr, "Can't open %s.\n", argv[1]);
+    if(recursive){
+	tree_result tres;
+	int status = copy_tree(source, dest, &tree, &tres);
+	if(status == -1 && tres.errors == 0){
+	    perror(source);
+	    exit(EXIT_FAILURE);
+	}
+	fprintf(stderr, "%ld files, %ld dirs, %ld links, %lld bytes, %.3f s, %.1f MB/s, %.0f files/s\n",
+		tres.files, tres.dirs, tres.links, (long long)tres.bytes, tres.seconds,
+		tres.bytes / tres.seconds / 1e6, tres.files / tres.seconds);
+	return status == 0 ? 0 : EXIT_FAILURE;
+    }
+
+    if((source_fd = open(source, O_RDONLY | direct)) == -1){
+	fprintf(stderr, "Can't open %s.\n", source);
 	exit(EXIT_FAILURE);
     }
 
-    if((dest_fp = fopen(argv[2], "wb")) == NULL){
-	fprintf(stderr, "Can't open %s\n", argv[2]);
-	fclose(source_fp);
+    if(strcmp(dest, "-") == 0)
+	dest_fd = STDOUT_FILENO;
+    else if((dest_fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC | direct, 0644)) == -1){
+	fprintf(stderr, "Can't open %s\n", dest);
+	close(source_fd);
 	exit(EXIT_FAILURE);
     }
 
-    while((ch = getc(source_fp)) != EOF){
-	putc(ch, dest_fp);
+    int status = use_uring ? copy_uring(source_fd, dest_fd, &uring, &res)
+			   : copy_fd(source_fd, dest_fd, &opt, &res);
+    if(res.verified)
+	fprintf(stderr, "crc32c source %08x destination %08x %s\n", res.src_crc, res.dst_crc,
+		res.src_crc == res.dst_crc ? "OK" : "MISMATCH");
+    if(status == -1){
+	perror("copy");
+	exit(EXIT_FAILURE);
+    }
+    fprintf(stderr, "%lld bytes via %s, %.3f s, %.1f MB/s\n", (long long)res.bytes,
+	    copy_method_name(res.used), res.seconds, copy_mb_per_s(&res));
+    if(opt.sparse){
+	fprintf(stderr, "%lld bytes of holes skipped\n", (long long)res.skipped);
+	report_blocks("source", source_fd);
+	report_blocks("destination", dest_fd);
     }
 
-    fclose(dest_fp);
-    fclose(source_fp);
+    if(dest_fd != STDOUT_FILENO)
+	close(dest_fd);
+    close(source_fd);
     return 0;
 }
@@ -1,5 +1,26 @@
 // char *bsearch(void *key, void *base, int n, int elemsize, int (*cmpfn)(void*, void*));
+/* it lives in binsearch.c now, as binsearch
+   gcc binary_search.c binsearch.c lsearch.c lsearch_simd.c -o binary_search */
+#include <stdio.h>
+#include "binsearch.h"
+#include "lsearch.h"
+
 int main(void){
-	printf("Hello world.\n");
+	int sorted[] = {2, 3, 5, 7, 11, 13, 17, 19, 23};
+	int n = sizeof(sorted) / sizeof(sorted[0]);
+	int eyt[sizeof(sorted) / sizeof(sorted[0]) + 1];
+	int key = 13;
+
+	eytzinger_build(eyt, sorted, n, sizeof(int));
+	int *found = binsearch(&key, sorted, n, sizeof(int), intCmp);
+	int *branchless = binsearch_branchless(&key, sorted, n, sizeof(int), intCmp);
+	int *tree = eytzinger_search(&key, eyt, n, sizeof(int), intCmp);
+
+	printf("binsearch  -> index %ld\n", found - sorted);
+	printf("branchless -> index %ld\n", branchless - sorted);
+	printf("eytzinger  -> slot %ld of", tree - eyt);
+	for(int i = 1; i <= n; i++)
+		printf(" %d", eyt[i]);
+	printf("\n");
 	return 0;
 }
@@ -0,0 +1,96 @@
+#include <string.h>
+#include "binsearch.h"
+
+void *binsearch(void *key, void *base, int n, int elemsize, int (*cmpfn)(void *, void *)){
+	int lo = 0, hi = n - 1;
+	while(lo <= hi){
+		int mid = lo + (hi - lo) / 2;
+		void *elemaddr = (char *)base + (size_t)mid * elemsize;
+		int cmp = cmpfn(key, elemaddr);
+		if(cmp == 0)
+			return elemaddr;
+		if(cmp < 0)
+			hi = mid - 1;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+/* after the loop the first element >= key is lo or the one right after
+   it (if there is one). The only branch left is the loop itself */
+void *binsearch_branchless(void *key, void *base, int n, int elemsize, int (*cmpfn)(void *, void *)){
+	char *lo = base;
+	char *last = (char *)base + (size_t)(n - 1) * elemsize;
+	if(n <= 0)
+		return NULL;
+	while(n > 1){
+		int half = n / 2;
+		char *mid = lo + (size_t)half * elemsize;
+		lo = cmpfn(mid, key) < 0 ? mid : lo;
+		n -= half;
+	}
+	if(cmpfn(lo, key) < 0 && lo != last)
+		lo += elemsize;
+	return cmpfn(key, lo) == 0 ? lo : NULL;
+}
+
+int *binsearch_branchless_int(int key, const int *base, int n){
+	const int *lo = base;
+	const int *last = base + n - 1;
+	if(n <= 0)
+		return NULL;
+	while(n > 1){
+		int half = n / 2;
+		lo = lo[half] < key ? lo + half : lo;
+		n -= half;
+	}
+	lo += *lo < key && lo != last;
+	return *lo == key ? (int *)lo : NULL;
+}
+
+/* in order walk of the implicit tree, handing out sorted elements */
+static int eytzinger_fill(char *dst, const char *sorted, int i, int k, int n, int elemsize){
+	if(k <= n){
+		i = eytzinger_fill(dst, sorted, i, 2 * k, n, elemsize);
+		memcpy(dst + (size_t)k * elemsize, sorted + (size_t)i * elemsize, elemsize);
+		i++;
+		i = eytzinger_fill(dst, sorted, i, 2 * k + 1, n, elemsize);
+	}
+	return i;
+}
+
+void eytzinger_build(void *dst, const void *sorted, int n, int elemsize){
+	eytzinger_fill(dst, sorted, 0, 1, n, elemsize);
+}
+
+/* k descends left on >= and right on <. At the end the path bits say
+   where the lower bound was: drop the trailing right turns (the 1 bits)
+   plus one left turn and k is the slot of the lower bound, 0 if every
+   element is < key.
+   4 levels down, the 16 great-great-grandchildren of k sit next to
+   each other at 16 * k .. 16 * k + 15: prefetching 16 * k brings them
+   all in (one cache line for 4 byte elements) */
+void *eytzinger_search(void *key, void *eyt, int n, int elemsize, int (*cmpfn)(void *, void *)){
+	char *base = eyt;
+	unsigned long k = 1;
+	while(k <= (unsigned long)n){
+		__builtin_prefetch(base + 16 * (size_t)k * elemsize);
+		k = 2 * k + (cmpfn(base + (size_t)k * elemsize, key) < 0);
+	}
+	k >>= __builtin_ctzl(~k) + 1;
+	if(k == 0)
+		return NULL;
+	void *elemaddr = base + (size_t)k * elemsize;
+	return cmpfn(key, elemaddr) == 0 ? elemaddr : NULL;
+}
+
+int *eytzinger_search_int(int key, const int *eyt, int n){
+	unsigned long k = 1;
+	while(k <= (unsigned long)n){
+		__builtin_prefetch(eyt + 16 * k);
+		k = 2 * k + (eyt[k] < key);
+	}
+	k >>= __builtin_ctzl(~k) + 1;
+	return k != 0 && eyt[k] == key ? (int *)(eyt + k) : NULL;
+}
@@ -0,0 +1,25 @@
+#ifndef BINSEARCH_H
+#define BINSEARCH_H
+
+/* binsearch is the bsearch from binary_search.c, renamed so it doesn't
+   clash with the one in stdlib.h. base must be sorted by cmpfn.
+
+   > binsearch             the textbook loop, stops early on a hit
+   > binsearch_branchless  always log2(n) steps, the step is a
+                           conditional move instead of a branch
+   > eytzinger_*           the array rearranged in BFS order of the
+                           search tree (slot 1 the root, 2k and 2k+1 its
+                           children), the top levels share cache lines
+                           and the next levels are prefetched
+ */
+void *binsearch(void *key, void *base, int n, int elemsize, int (*cmpfn)(void *, void *));
+void *binsearch_branchless(void *key, void *base, int n, int elemsize, int (*cmpfn)(void *, void *));
+
+/* dst needs room for n + 1 elements, slot 0 is left unused */
+void eytzinger_build(void *dst, const void *sorted, int n, int elemsize);
+void *eytzinger_search(void *key, void *eyt, int n, int elemsize, int (*cmpfn)(void *, void *));
+
+/* the same two for plain int arrays, no function pointer at all */
+int *binsearch_branchless_int(int key, const int *base, int n);
+int *eytzinger_search_int(int key, const int *eyt, int n);
+#endif
@@ -0,0 +1,88 @@
+/* libc bsearch against binsearch, the branchless versions and the
+   Eytzinger layout, with the table sized for L1, L2, L3 and DRAM.
+   Half the keys are present. ./binsearch_bench [dram elements]
+
+   gcc -O2 binsearch_bench.c binsearch.c lsearch.c lsearch_simd.c -o binsearch_bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "binsearch.h"
+#include "lsearch.h"
+
+#define QUERIES 2000000
+
+static int libcCmp(const void *vp1, const void *vp2){
+	int a = *(const int *)vp1, b = *(const int *)vp2;
+	return (a > b) - (a < b);
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+enum { LIBC, GENERIC, BRANCHLESS, BRANCHLESS_INT, EYTZINGER, EYTZINGER_INT, WAYS };
+static const char *names[WAYS] = { "libc", "binsearch", "branchless", "bl_int", "eytzinger", "eyt_int" };
+
+static double run(int way, int *sorted, int *eyt, int n, int *keys){
+	long found = 0;
+	double t0 = now();
+	for(int q = 0; q < QUERIES; q++){
+		int key = keys[q];
+		void *hit;
+		switch(way){
+			case LIBC: hit = bsearch(&key, sorted, n, sizeof(int), libcCmp); break;
+			case GENERIC: hit = binsearch(&key, sorted, n, sizeof(int), intCmp); break;
+			case BRANCHLESS: hit = binsearch_branchless(&key, sorted, n, sizeof(int), intCmp); break;
+			case BRANCHLESS_INT: hit = binsearch_branchless_int(key, sorted, n); break;
+			case EYTZINGER: hit = eytzinger_search(&key, eyt, n, sizeof(int), intCmp); break;
+			default: hit = eytzinger_search_int(key, eyt, n); break;
+		}
+		found += hit != NULL;
+	}
+	double elapsed = now() - t0;
+	if(found < QUERIES / 3 || found > 2 * QUERIES / 3)
+		printf("?? %s found %ld of %d\n", names[way], found, QUERIES);
+	return elapsed * 1e9 / QUERIES;
+}
+
+int main(int argc, char *argv[]){
+	int sizes[] = { 4096, 65536, 1 << 20, 32 << 20 };	/* 16K 256K 4M 128M bytes */
+	const char *levels[] = { "L1", "L2", "L3", "DRAM" };
+	if(argc > 1)
+		sizes[3] = atoi(argv[1]);
+
+	int *keys = malloc(QUERIES * sizeof(int));
+	printf("%5s %10s", "", "n");
+	for(int w = 0; w < WAYS; w++)
+		printf(" %10s", names[w]);
+	printf("   (ns/lookup)\n");
+
+	for(int s = 0; s < 4; s++){
+		int n = sizes[s];
+		int *sorted = malloc(n * sizeof(int));
+		int *eyt = malloc((n + 1) * sizeof(int));
+		if(sorted == NULL || eyt == NULL){
+			fprintf(stderr, "no memory for %d elements\n", n);
+			return EXIT_FAILURE;
+		}
+		for(int i = 0; i < n; i++)
+			sorted[i] = 2 * i;
+		eytzinger_build(eyt, sorted, n, sizeof(int));
+
+		srand(s + 1);
+		for(int q = 0; q < QUERIES; q++)
+			keys[q] = (int)(((long)rand() * RAND_MAX + rand()) % (2L * n));
+
+		printf("%5s %10d", levels[s], n);
+		for(int w = 0; w < WAYS; w++)
+			printf(" %10.1f", run(w, sorted, eyt, n, keys));
+		printf("\n");
+		free(sorted);
+		free(eyt);
+	}
+	free(keys);
+	return 0;
+}
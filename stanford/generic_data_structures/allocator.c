@@ -0,0 +1,21 @@
+#include "allocator.h"
+#include <stdlib.h>
+
+static void *heap_alloc(void *ctx, size_t size){
+	(void)ctx;
+	return malloc(size);
+}
+
+static void *heap_resize(void *ctx, void *p, size_t oldsize, size_t newsize){
+	(void)ctx;
+	(void)oldsize;
+	return realloc(p, newsize);
+}
+
+static void heap_release(void *ctx, void *p, size_t size){
+	(void)ctx;
+	(void)size;
+	free(p);
+}
+
+const allocator malloc_allocator = { heap_alloc, heap_resize, heap_release, NULL };
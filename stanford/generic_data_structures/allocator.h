@@ -0,0 +1,19 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stddef.h>
+
+/* What a container needs from memory. Sizes are passed back on resize
+   and release so allocators that don't keep headers (an arena) can
+   still do the right thing. ctx is the allocator's own state. */
+typedef struct{
+	void *(*alloc)(void *ctx, size_t size);
+	void *(*resize)(void *ctx, void *p, size_t oldsize, size_t newsize);
+	void (*release)(void *ctx, void *p, size_t size);
+	void *ctx;
+}allocator;
+
+/* plain malloc/realloc/free, the default everywhere */
+extern const allocator malloc_allocator;
+
+#endif
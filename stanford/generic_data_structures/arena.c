@@ -0,0 +1,107 @@
+#include "arena.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+void arena_new(arena *a, size_t chunksize, size_t align){
+	assert(chunksize > 0);
+	assert(align > 0 && (align & (align - 1)) == 0);
+	a->current = NULL;
+	a->chunksize = chunksize;
+	a->align = align;
+	a->last = NULL;
+}
+
+static arena_chunk *arena_add_chunk(arena *a, size_t need){
+	size_t size = need > a->chunksize ? need : a->chunksize;
+	arena_chunk *chunk = malloc(sizeof(arena_chunk) + size);
+	assert(chunk != NULL);
+	chunk->prev = a->current;
+	chunk->size = size;
+	chunk->used = 0;
+	a->current = chunk;
+	return chunk;
+}
+
+/* alignment is done on the real address, not on the offset, so
+   anything up to the malloc alignment and beyond works */
+static size_t arena_padding(arena_chunk *chunk, size_t align){
+	uintptr_t at = (uintptr_t)(chunk->data + chunk->used);
+	return (align - (at & (align - 1))) & (align - 1);
+}
+
+void *arena_alloc_aligned(arena *a, size_t size, size_t align){
+	assert(align > 0 && (align & (align - 1)) == 0);
+	arena_chunk *chunk = a->current;
+	size_t pad = chunk != NULL ? arena_padding(chunk, align) : 0;
+
+	if(chunk == NULL || chunk->used + pad + size > chunk->size){
+		chunk = arena_add_chunk(a, size + align - 1);
+		pad = arena_padding(chunk, align);
+	}
+	void *p = chunk->data + chunk->used + pad;
+	chunk->used += pad + size;
+	a->last = p;
+	return p;
+}
+
+void *arena_alloc(arena *a, size_t size){
+	return arena_alloc_aligned(a, size, a->align);
+}
+
+arena_mark arena_get_mark(arena *a){
+	arena_mark mark = { a->current, a->current != NULL ? a->current->used : 0 };
+	return mark;
+}
+
+/* frees every chunk opened after the mark, rewinds the one it was in.
+   A zero mark ({NULL, 0}) throws everything away */
+void arena_reset(arena *a, arena_mark mark){
+	while(a->current != mark.chunk){
+		assert(a->current != NULL);	/* mark is not from this arena */
+		arena_chunk *prev = a->current->prev;
+		free(a->current);
+		a->current = prev;
+	}
+	if(a->current != NULL)
+		a->current->used = mark.used;
+	a->last = NULL;
+}
+
+void arena_destroy(arena *a){
+	arena_reset(a, (arena_mark){ NULL, 0 });
+}
+
+static void *arena_iface_alloc(void *ctx, size_t size){
+	return arena_alloc(ctx, size);
+}
+
+/* the last block handed out can simply grow, the rest gets copied and
+   the old space is left behind until the arena goes */
+static void *arena_iface_resize(void *ctx, void *p, size_t oldsize, size_t newsize){
+	arena *a = ctx;
+	arena_chunk *chunk = a->current;
+	if(p != NULL && p == a->last){
+		size_t start = (char *)p - chunk->data;
+		if(start + newsize <= chunk->size){
+			chunk->used = start + newsize;
+			return p;
+		}
+	}
+	void *fresh = arena_alloc(a, newsize);
+	if(p != NULL)
+		memcpy(fresh, p, oldsize < newsize ? oldsize : newsize);
+	return fresh;
+}
+
+static void arena_iface_release(void *ctx, void *p, size_t size){
+	(void)ctx;
+	(void)p;
+	(void)size;
+}
+
+allocator arena_allocator(arena *a){
+	allocator al = { arena_iface_alloc, arena_iface_resize, arena_iface_release, a };
+	return al;
+}
@@ -0,0 +1,45 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include "allocator.h"
+
+/* Bump pointer arena.
+   Memory comes from a chain of chunks and is only given back all at
+   once: arena_reset to a mark, or arena_destroy. Everything built for
+   one request can go in one arena and die with it, no per container
+   dispose needed.
+
+   > align is the default alignment of arena_alloc (a power of two)
+   > a request that doesn't fit in what is left of the current chunk
+     opens a new one (of its own size if bigger than chunksize). The
+     rest of the old chunk is wasted until a reset rewinds into it
+ */
+
+typedef struct arena_chunk{
+	struct arena_chunk *prev;
+	size_t size, used;
+	_Alignas(16) char data[];
+}arena_chunk;
+
+typedef struct{
+	arena_chunk *current;
+	size_t chunksize, align;
+	void *last;		/* last allocation, resize can grow it in place */
+}arena;
+
+typedef struct{
+	arena_chunk *chunk;
+	size_t used;
+}arena_mark;
+
+void arena_new(arena *a, size_t chunksize, size_t align);
+void *arena_alloc(arena *a, size_t size);
+void *arena_alloc_aligned(arena *a, size_t size, size_t align);
+arena_mark arena_get_mark(arena *a);
+void arena_reset(arena *a, arena_mark mark);
+void arena_destroy(arena *a);
+
+/* the allocator interface on top of an arena, release is a no-op */
+allocator arena_allocator(arena *a);
+#endif
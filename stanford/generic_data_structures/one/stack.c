@@ -1,28 +1,60 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "stack.h"
 
+stack_alloc_stats stack_stats;
+
 void stack_new(stack *s)
 {
     s->logicallen = 0;
     s->alloclen = 4;
     s->elements = malloc(4 * sizeof(int));
     assert(s->elements != NULL);
+    stack_stats.mallocs++;
+}
+
+void stack_new_small(stack *s, int inlinelen)
+{
+    assert(inlinelen > 0 && inlinelen <= STACK_INLINE_INTS);
+    s->logicallen = 0;
+    s->alloclen = inlinelen;
+    s->elements = s->inlineelems;
 }
 
 void stack_dispose(stack *s)
 {
-    if(s->elements != NULL)
-	free(s->elements);
+    if(s->elements != NULL){
+	if(s->elements != s->inlineelems){
+	    free(s->elements);
+	    stack_stats.frees++;
+	}
+	s->elements = NULL;
+    }
+}
+
+/* grows to alloclen elements, the first time off the inline buffer
+   it is a malloc + copy instead of a realloc */
+static void stack_resize(stack *s, int alloclen)
+{
+    if(s->elements == s->inlineelems){
+	s->elements = malloc(alloclen * sizeof(int));
+	assert(s->elements != NULL);
+	memcpy(s->elements, s->inlineelems, s->logicallen * sizeof(int));
+	stack_stats.mallocs++;
+    }else{
+	s->elements = realloc(s->elements, alloclen * sizeof(int));
+	assert(s->elements != NULL);
+	stack_stats.reallocs++;
+    }
+    s->alloclen = alloclen;
 }
 
 void stack_push(stack *s, int value)
 {
     if(s->logicallen == s->alloclen){
-	s->alloclen *= 2;
-	s->elements = realloc(s->elements, s->alloclen * sizeof(int));
-	assert(s->elements !=  NULL);
+	stack_resize(s, s->alloclen * 2);
 	printf("An increment was reached [ %i ] items [ %i ]\n", s->alloclen, s->logicallen);
     }
 
@@ -37,10 +69,31 @@ int stack_pop(stack *s)
     return s->elements[s->logicallen];
 }
 
-void stack_dispose(Stack *s){
-    if(s->elements != NULL){
-       	free(s->elements);
-	s->elements = NULL;
-    }
+/* makes room for n elements in total, still doubling so a run of
+   small reserves doesn't turn into a realloc each */
+void stack_reserve(stack *s, int n)
+{
+    int alloclen = s->alloclen;
+    if(n <= alloclen)
+	return;
+    while(alloclen < n)
+	alloclen *= 2;
+    stack_resize(s, alloclen);
 }
 
+void stack_push_n(stack *s, const int *values, int n)
+{
+    assert(n >= 0);
+    stack_reserve(s, s->logicallen + n);
+    memcpy(s->elements + s->logicallen, values, n * sizeof(int));
+    s->logicallen += n;
+}
+
+void stack_pop_n(stack *s, int *values, int n)
+{
+    assert(n >= 0 && s->logicallen >= n);
+    const int *top = s->elements + s->logicallen;
+    for (int i = 0; i < n; i++)
+	values[i] = top[-1 - i];
+    s->logicallen -= n;
+}
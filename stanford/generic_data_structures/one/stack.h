@@ -1,14 +1,34 @@
 #ifndef STACK_H
-#define STACK
+#define STACK_H
+/* small buffer mode: elements == inlineelems until the stack outgrows
+   it, only then is the heap used. Don't copy such a stack around. */
+#ifndef STACK_INLINE_INTS
+#define STACK_INLINE_INTS 16
+#endif
+
 typedef struct{
     int *elements;
     int logicallen, alloclen;
+    int inlineelems[STACK_INLINE_INTS];
 }stack;
 
+/* malloc/realloc/free calls made by stack.c */
+typedef struct{
+    long mallocs, reallocs, frees;
+}stack_alloc_stats;
+
+extern stack_alloc_stats stack_stats;
 
 void stack_new(stack *s);
+void stack_new_small(stack *s, int inlinelen);
 void stack_dispose(stack *s);
 void stack_push(stack *s, int value);
 int stack_pop(stack *s);
-#endif
 
+/* batch versions: capacity is checked once, push_n is one memcpy.
+   stack_pop_n hands the values out top first, same as n stack_pop
+   calls would: after push_n(a, n), pop_n(b, n) gives b[i] == a[n-1-i] */
+void stack_reserve(stack *s, int n);
+void stack_push_n(stack *s, const int *values, int n);
+void stack_pop_n(stack *s, int *values, int n);
+#endif
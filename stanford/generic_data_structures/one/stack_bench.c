@@ -0,0 +1,65 @@
+/* per element cost of the one-at-a-time loop from main.c against
+   stack_push_n / stack_pop_n.
+   Both sides get the capacity up front (stack_reserve), otherwise the
+   loop side also pays for the growth printf in stack_push.
+   Both pop top first, so the two out[] must come out the same.
+
+   gcc -O2 stack_bench.c stack.c -o stack_bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "stack.h"
+
+#define N (1 << 20)
+#define ROUNDS 50
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+    int *values = malloc(N * sizeof(int));
+    int *out = malloc(N * sizeof(int));
+    long long check = 0, batch_check = 0;
+    stack newton;
+
+    for (int i = 0; i < N; i++)
+	values[i] = i;
+
+    stack_new(&newton);
+    stack_reserve(&newton, N);
+
+    double t0 = now();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+	for (int i = 0; i < N; i++)
+	    stack_push(&newton, values[i]);
+	for (int i = 0; i < N; i++)
+	    out[i] = stack_pop(&newton);
+	check += out[r];
+    }
+    double loop = now() - t0;
+
+    t0 = now();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+	stack_push_n(&newton, values, N);
+	stack_pop_n(&newton, out, N);
+	batch_check += out[r];
+    }
+    double batch = now() - t0;
+
+    printf("single loop   %6.3f ns/elem\n", loop * 1e9 / ((double)N * ROUNDS));
+    printf("push_n/pop_n  %6.3f ns/elem\n", batch * 1e9 / ((double)N * ROUNDS));
+    printf("(check %lld %lld)\n", check, batch_check);
+
+    stack_dispose(&newton);
+    free(values);
+    free(out);
+    return check == batch_check ? 0 : 1;
+}
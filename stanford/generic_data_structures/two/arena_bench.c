@@ -0,0 +1,69 @@
+/* one "request" builds a bunch of small stacks and throws them away.
+   malloc: every stack is stack_dispose'd on its own.
+   arena:  the stacks carve from one arena, teardown is one arena_reset.
+
+   gcc -O2 arena_bench.c stack.c ../allocator.c ../arena.c -o arena_bench
+ */
+#include "stack.h"
+#include "../arena.h"
+#include <stdio.h>
+#include <time.h>
+
+#define REQUESTS 20000
+#define STACKS 64	/* containers per request */
+#define PUSHES 100
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long long fill(stack *stacks, const allocator *a){
+	long long check = 0;
+	for(int i = 0; i < STACKS; i++){
+		stack_new_alloc(&stacks[i], sizeof(long), a);
+		for(long j = 0; j < PUSHES; j++)
+			stack_push(&stacks[i], &j);
+	}
+	for(int i = 0; i < STACKS; i++){
+		long x;
+		stack_pop(&stacks[i], &x);
+		check += x;
+	}
+	return check;
+}
+
+int main(void){
+	static stack stacks[STACKS];
+	long long check = 0;
+
+	double t0 = now();
+	for(int r = 0; r < REQUESTS; r++){
+		check += fill(stacks, &malloc_allocator);
+		for(int i = 0; i < STACKS; i++)
+			stack_dispose(&stacks[i]);
+	}
+	double heap = now() - t0;
+
+	arena request;
+	arena_new(&request, 64 * 1024, 16);
+	allocator from_arena = arena_allocator(&request);
+	/* mark after the first chunk exists, so reset keeps it instead of
+	   freeing every chunk and mallocing them again each request */
+	arena_alloc(&request, 1);
+	arena_mark empty = arena_get_mark(&request);
+
+	t0 = now();
+	for(int r = 0; r < REQUESTS; r++){
+		check += fill(stacks, &from_arena);
+		arena_reset(&request, empty);
+	}
+	double bump = now() - t0;
+	arena_destroy(&request);
+
+	printf("malloc + dispose  %8.2f us/request\n", heap * 1e6 / REQUESTS);
+	printf("arena + reset     %8.2f us/request\n", bump * 1e6 / REQUESTS);
+	printf("(check %lld)\n", check);
+	return 0;
+}
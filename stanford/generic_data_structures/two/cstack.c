@@ -0,0 +1,111 @@
+#include "cstack.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* segment k holds CSTACK_SEG0 << k nodes, so 32 segments are way more
+   than the 32 bit index can ever reach */
+#define CSTACK_SEG0 64
+#define CSTACK_NIL 0	/* index 0 is the NULL pointer, real nodes start at 1 */
+
+typedef struct{
+	_Atomic uint32_t next;
+	/* elemSize bytes of payload follow, 8 byte aligned */
+}cstack_node;
+
+#define NODE_DATA(n) ((char *)(n) + 8)
+#define PACK(tag, index) (((uint64_t)(tag) << 32) | (uint32_t)(index))
+#define INDEX(word) ((uint32_t)(word))
+#define TAG(word) ((uint32_t)((word) >> 32))
+
+void cstack_new(cstack *s, int elemSize){
+	assert(elemSize > 0);
+	s->elemSize = elemSize;
+	s->nodesize = 8 + ((elemSize + 7) & ~7);
+	atomic_init(&s->head, PACK(0, CSTACK_NIL));
+	atomic_init(&s->freelist, PACK(0, CSTACK_NIL));
+	atomic_init(&s->nextindex, 1);
+	for(int k = 0; k < CSTACK_SEGMENTS; k++)
+		atomic_init(&s->segments[k], NULL);
+}
+
+void cstack_dispose(cstack *s){
+	for(int k = 0; k < CSTACK_SEGMENTS; k++){
+		free(atomic_load(&s->segments[k]));
+		atomic_store(&s->segments[k], NULL);
+	}
+}
+
+/* index i (1 based) -> segment k and the offset inside it.
+   segment k starts at SEG0 * (2^k - 1) */
+static cstack_node *cstack_node_at(cstack *s, uint32_t index){
+	uint32_t i = index - 1;
+	int k = 31 - __builtin_clz(i / CSTACK_SEG0 + 1);
+	uint32_t offset = i - CSTACK_SEG0 * ((1u << k) - 1);
+	char *seg = atomic_load_explicit(&s->segments[k], memory_order_acquire);
+	return (cstack_node *)(seg + (size_t)offset * s->nodesize);
+}
+
+/* hands out a never used index, allocating its segment on the way.
+   Two threads may race to allocate the same segment, the CAS loser
+   frees its copy and uses the winner's. */
+static uint32_t cstack_fresh_index(cstack *s){
+	uint32_t index = atomic_fetch_add(&s->nextindex, 1);
+	assert(index != 0);	/* wrapped around 4 billion nodes */
+	uint32_t i = index - 1;
+	int k = 31 - __builtin_clz(i / CSTACK_SEG0 + 1);
+
+	if(atomic_load_explicit(&s->segments[k], memory_order_acquire) == NULL){
+		char *seg = malloc(((size_t)CSTACK_SEG0 << k) * s->nodesize);
+		assert(seg != NULL);
+		char *expected = NULL;
+		if(!atomic_compare_exchange_strong(&s->segments[k], &expected, seg))
+			free(seg);
+	}
+	return index;
+}
+
+/* the core Treiber loops, used both for the stack itself and
+   for the free list of recycled nodes */
+static void cstack_link(cstack *s, _Atomic uint64_t *top, uint32_t index){
+	cstack_node *node = cstack_node_at(s, index);
+	uint64_t old = atomic_load_explicit(top, memory_order_relaxed);
+	do{
+		atomic_store_explicit(&node->next, INDEX(old), memory_order_relaxed);
+	}while(!atomic_compare_exchange_weak_explicit(top, &old,
+				PACK(TAG(old) + 1, index),
+				memory_order_release, memory_order_relaxed));
+}
+
+static uint32_t cstack_unlink(cstack *s, _Atomic uint64_t *top){
+	uint64_t old = atomic_load_explicit(top, memory_order_acquire);
+	while(INDEX(old) != CSTACK_NIL){
+		/* node may be popped and reused under our feet, then next is
+		   garbage, but the tag makes the CAS below fail */
+		cstack_node *node = cstack_node_at(s, INDEX(old));
+		uint32_t next = atomic_load_explicit(&node->next, memory_order_relaxed);
+		if(atomic_compare_exchange_weak_explicit(top, &old,
+					PACK(TAG(old) + 1, next),
+					memory_order_acquire, memory_order_acquire))
+			return INDEX(old);
+	}
+	return CSTACK_NIL;
+}
+
+void cstack_push(cstack *s, const void *elem_addr){
+	uint32_t index = cstack_unlink(s, &s->freelist);
+	if(index == CSTACK_NIL)
+		index = cstack_fresh_index(s);
+	memcpy(NODE_DATA(cstack_node_at(s, index)), elem_addr, s->elemSize);
+	cstack_link(s, &s->head, index);
+}
+
+bool cstack_try_pop(cstack *s, void *elem_addr){
+	uint32_t index = cstack_unlink(s, &s->head);
+	if(index == CSTACK_NIL)
+		return false;
+	/* we own the node now, nobody can recycle it before we link it back */
+	memcpy(elem_addr, NODE_DATA(cstack_node_at(s, index)), s->elemSize);
+	cstack_link(s, &s->freelist, index);
+	return true;
+}
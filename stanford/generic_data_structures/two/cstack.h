@@ -0,0 +1,35 @@
+#ifndef CSTACK_H
+#define CSTACK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* A lock-free (Treiber) version of the generic stack.
+   Same elemSize idea as stack.h but many threads can push and pop
+   at the same time without a mutex.
+
+   > nodes live in a pool of segments and are never handed back to
+     malloc until cstack_dispose, so a popper reading node->next of a
+     node somebody else just took is still reading valid memory.
+   > the head (and the free list) is a 64 bit word: the low 32 bits are
+     the node index, the high 32 bits a tag bumped on every update.
+     That tag is what beats the ABA problem (pop A, push B, push A back
+     -> a stale CAS still sees a different tag and fails).
+ */
+
+#define CSTACK_SEGMENTS 32
+
+typedef struct{
+	_Atomic uint64_t head;		/* tag << 32 | index of top node */
+	_Atomic uint64_t freelist;	/* same layout, recycled nodes */
+	_Atomic uint32_t nextindex;	/* first never used node index */
+	_Atomic(char *) segments[CSTACK_SEGMENTS];
+	int elemSize, nodesize;
+}cstack;
+
+void cstack_new(cstack *s, int elemSize);
+void cstack_dispose(cstack *s);
+void cstack_push(cstack *s, const void *elem_addr);
+bool cstack_try_pop(cstack *s, void *elem_addr);
+#endif
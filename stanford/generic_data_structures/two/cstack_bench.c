@@ -0,0 +1,127 @@
+/* cstack vs the plain stack behind one global mutex.
+   Every thread pushes and pops OPS values, then we check that nothing got
+   lost or duplicated (sum of everything pushed == sum popped + leftovers).
+
+   gcc -O2 -pthread cstack_bench.c cstack.c stack.c ../allocator.c -o cstack_bench
+ */
+#include "cstack.h"
+#include "stack.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OPS 200000
+#define MAXTHREADS 64
+
+typedef struct{
+	int id;
+	uint64_t pushed, popped;
+}worker;
+
+static cstack lockfree;
+static stack locked;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_barrier_t start;
+
+static uint64_t value_for(int id, int i){
+	return ((uint64_t)id << 32) | (uint32_t)i;
+}
+
+static void *run_cstack(void *arg){
+	worker *w = arg;
+	uint64_t v;
+	pthread_barrier_wait(&start);
+	for(int i = 0; i < OPS; i++){
+		v = value_for(w->id, i);
+		cstack_push(&lockfree, &v);
+		w->pushed += v;
+		if(i & 1 && cstack_try_pop(&lockfree, &v))
+			w->popped += v;
+	}
+	return NULL;
+}
+
+static void *run_locked(void *arg){
+	worker *w = arg;
+	uint64_t v;
+	pthread_barrier_wait(&start);
+	for(int i = 0; i < OPS; i++){
+		v = value_for(w->id, i);
+		pthread_mutex_lock(&lock);
+		stack_push(&locked, &v);
+		pthread_mutex_unlock(&lock);
+		w->pushed += v;
+		if(i & 1){
+			pthread_mutex_lock(&lock);
+			if(locked.loglen > 0){
+				stack_pop(&locked, &v);
+				w->popped += v;
+			}
+			pthread_mutex_unlock(&lock);
+		}
+	}
+	return NULL;
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* returns ops per second, aborts if the sums don't add up */
+static double run(int nthreads, void *(*fn)(void *), int lockfree_run){
+	pthread_t threads[MAXTHREADS];
+	worker workers[MAXTHREADS];
+	uint64_t pushed = 0, popped = 0, v;
+
+	pthread_barrier_init(&start, NULL, nthreads + 1);
+	for(int i = 0; i < nthreads; i++){
+		workers[i] = (worker){ .id = i };
+		pthread_create(&threads[i], NULL, fn, &workers[i]);
+	}
+	double t0 = now();
+	pthread_barrier_wait(&start);
+	for(int i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	double elapsed = now() - t0;
+	pthread_barrier_destroy(&start);
+
+	for(int i = 0; i < nthreads; i++){
+		pushed += workers[i].pushed;
+		popped += workers[i].popped;
+	}
+	if(lockfree_run){
+		while(cstack_try_pop(&lockfree, &v))
+			popped += v;
+	}else{
+		while(locked.loglen > 0){
+			stack_pop(&locked, &v);
+			popped += v;
+		}
+	}
+	if(pushed != popped){
+		fprintf(stderr, "%s lost values with %d threads\n",
+				lockfree_run ? "cstack" : "stack", nthreads);
+		exit(EXIT_FAILURE);
+	}
+	return nthreads * (OPS + OPS / 2) / elapsed;
+}
+
+int main(void){
+	cstack_new(&lockfree, sizeof(uint64_t));
+	stack_new(&locked, sizeof(uint64_t));
+
+	printf("%8s %16s %16s\n", "threads", "mutex+stack", "cstack");
+	for(int n = 1; n <= MAXTHREADS; n *= 2){
+		double slow = run(n, run_locked, 0);
+		double fast = run(n, run_cstack, 1);
+		printf("%8d %13.2f M/s %13.2f M/s\n", n, slow / 1e6, fast / 1e6);
+	}
+
+	cstack_dispose(&lockfree);
+	stack_dispose(&locked);
+	return 0;
+}
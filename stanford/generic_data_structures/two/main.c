@@ -1,3 +1,4 @@
+/* gcc main.c stack.c ../allocator.c -o main */
 #include "stack.h"
 #include <string.h>
 #include <stdlib.h>
@@ -0,0 +1,122 @@
+#define _GNU_SOURCE
+#include "pstack.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PSTACK_MAGIC "pstack1"
+#define PSTACK_INITIAL 64	/* elements in a brand new file */
+
+static size_t pstack_filesize(int64_t alloclength, int elemSize){
+	return sizeof(pstack_header) + (size_t)alloclength * elemSize;
+}
+
+static void pstack_attach(pstack *s, void *map, size_t mapsize){
+	s->hdr = map;
+	s->elems = (char *)map + sizeof(pstack_header);
+	s->mapsize = mapsize;
+}
+
+int pstack_open(pstack *s, const char *path, int elemSize){
+	struct stat st;
+	assert(elemSize > 0);
+	int fd = open(path, O_RDWR | O_CREAT, 0644);
+	if(fd == -1)
+		return -1;
+	if(fstat(fd, &st) == -1)
+		goto fail;
+
+	int fresh = st.st_size == 0;
+	if(fresh){
+		if(ftruncate(fd, pstack_filesize(PSTACK_INITIAL, elemSize)) == -1)
+			goto fail;
+		st.st_size = pstack_filesize(PSTACK_INITIAL, elemSize);
+	}else if((size_t)st.st_size < sizeof(pstack_header)){
+		errno = EINVAL;
+		goto fail;
+	}
+
+	void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(map == MAP_FAILED)
+		goto fail;
+	s->fd = fd;
+	pstack_attach(s, map, st.st_size);
+
+	if(fresh){
+		memcpy(s->hdr->magic, PSTACK_MAGIC, sizeof(s->hdr->magic));
+		s->hdr->elemSize = elemSize;
+		s->hdr->loglen = 0;
+		s->hdr->alloclength = PSTACK_INITIAL;
+	}else if(memcmp(s->hdr->magic, PSTACK_MAGIC, sizeof(s->hdr->magic)) != 0
+			|| s->hdr->elemSize != elemSize
+			|| s->hdr->alloclength <= 0
+			|| s->hdr->alloclength > (int64_t)((st.st_size - sizeof(pstack_header)) / elemSize)
+			|| s->hdr->loglen < 0 || s->hdr->loglen > s->hdr->alloclength){
+		munmap(map, st.st_size);
+		errno = EINVAL;
+		goto fail;
+	}
+	return 0;
+
+fail:
+	{
+		int saved = errno;
+		close(fd);
+		errno = saved;
+	}
+	return -1;
+}
+
+/* the new pages get real blocks now (posix_fallocate), a sparse file
+   would only run out of disk on the memcpy, as SIGBUS. On failure the
+   file goes back to its old size */
+static int pstack_grow(pstack *s){
+	int64_t alloclength = s->hdr->alloclength * 2;
+	size_t size = pstack_filesize(alloclength, s->hdr->elemSize);
+	int err = posix_fallocate(s->fd, s->mapsize, size - s->mapsize);
+	void *map = err ? MAP_FAILED : mremap(s->hdr, s->mapsize, size, MREMAP_MAYMOVE);
+	if(map == MAP_FAILED){
+		if(!err)
+			err = errno;
+		ftruncate(s->fd, s->mapsize);
+		errno = err;
+		return -1;
+	}
+	pstack_attach(s, map, size);
+	s->hdr->alloclength = alloclength;
+	return 0;
+}
+
+/* -1 only if the file can't grow (disk full, ...), the stack is
+   unchanged in that case */
+int pstack_push(pstack *s, const void *elem_addr){
+	if(s->hdr->loglen == s->hdr->alloclength && pstack_grow(s) == -1)
+		return -1;
+	memcpy(s->elems + s->hdr->loglen * s->hdr->elemSize, elem_addr, s->hdr->elemSize);
+	s->hdr->loglen++;
+	return 0;
+}
+
+void pstack_pop(pstack *s, void *elem_addr){
+	assert(s->hdr->loglen > 0);
+	s->hdr->loglen--;
+	memcpy(elem_addr, s->elems + s->hdr->loglen * s->hdr->elemSize, s->hdr->elemSize);
+}
+
+int pstack_sync(pstack *s){
+	return msync(s->hdr, s->mapsize, MS_SYNC);
+}
+
+/* no implicit sync, the pages are shared with the file anyway and the
+   kernel writes them back on its own time */
+void pstack_close(pstack *s){
+	munmap(s->hdr, s->mapsize);
+	close(s->fd);
+	s->hdr = NULL;
+	s->elems = NULL;
+	s->fd = -1;
+}
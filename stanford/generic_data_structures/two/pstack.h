@@ -0,0 +1,49 @@
+#ifndef PSTACK_H
+#define PSTACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The generic stack kept in a memory mapped file, so it survives the
+   process. The file is
+
+	[ header (64 bytes) | alloclength * elemSize bytes of elements ]
+
+   and it is mapped MAP_SHARED, pushes and pops just touch memory.
+   Opening an existing file maps it, nothing is read up front, pages
+   come in as they are used.
+
+   > growth doubles alloclength: ftruncate the file, then mremap
+   > pstack_sync is the durability point: once it returns, the file
+     holds the stack as it is. Between syncs the kernel writes dirty
+     pages back whenever and in any order, header page included, so
+     after a crash loglen may be the synced one or a newer one, and
+     the elements pushed since the sync may or may not be on disk. The
+     top elements can be garbage then; sync after each push that has
+     to survive
+   > Linux only (mremap)
+ */
+
+typedef struct{
+	char magic[8];
+	int32_t elemSize, pad;
+	int64_t loglen, alloclength;
+	char reserved[32];
+}pstack_header;
+
+typedef struct{
+	int fd;
+	pstack_header *hdr;	/* start of the mapping */
+	char *elems;		/* right after the header */
+	size_t mapsize;
+}pstack;
+
+/* creates the file if it isn't there, returns -1 and sets errno on
+   failure (EINVAL: the file holds a different elemSize, isn't ours
+   or its header doesn't add up) */
+int pstack_open(pstack *s, const char *path, int elemSize);
+int pstack_push(pstack *s, const void *elem_addr);
+void pstack_pop(pstack *s, void *elem_addr);
+int pstack_sync(pstack *s);
+void pstack_close(pstack *s);
+#endif
@@ -0,0 +1,47 @@
+/* a tiny work backlog that outlives the process
+
+	./pstack_main backlog.bin push 1000000
+	./pstack_main backlog.bin pop 10
+
+   gcc -O2 pstack_main.c pstack.c -o pstack_main
+ */
+#include "pstack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char *argv[]){
+	pstack backlog;
+	if(argc != 4){
+		fprintf(stderr, "Usage: %s file push|pop count\n", argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	if(pstack_open(&backlog, argv[1], sizeof(long)) == -1){
+		perror(argv[1]);
+		exit(EXIT_FAILURE);
+	}
+	printf("reopened with %lld items\n", (long long)backlog.hdr->loglen);
+
+	long count = atol(argv[3]);
+	if(strcmp(argv[2], "push") == 0){
+		long next = backlog.hdr->loglen;
+		for(long i = 0; i < count; i++, next++){
+			if(pstack_push(&backlog, &next) == -1){
+				perror("push");
+				break;
+			}
+		}
+	}else{
+		for(long i = 0; i < count && backlog.hdr->loglen > 0; i++){
+			long item;
+			pstack_pop(&backlog, &item);
+			printf("%ld\n", item);
+		}
+	}
+
+	if(pstack_sync(&backlog) == -1)
+		perror("msync");
+	printf("%lld items left\n", (long long)backlog.hdr->loglen);
+	pstack_close(&backlog);
+	return 0;
+}
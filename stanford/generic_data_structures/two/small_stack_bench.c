@@ -0,0 +1,53 @@
+/* lots of short lived tiny stacks, like one per request:
+   stack_new (malloc up front) against stack_new_small (inline buffer),
+   with the allocation counters from stack.c.
+
+   gcc -O2 small_stack_bench.c stack.c ../allocator.c -o small_stack_bench
+ */
+#include "stack.h"
+#include <stdio.h>
+#include <time.h>
+
+#define STACKS 1000000
+#define DEPTH 6		/* pushes per stack, fits in 8 inline ints */
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(const char *name, int small){
+	stack_alloc_stats before = stack_stats;
+	long long check = 0;
+	double t0 = now();
+
+	for(int i = 0; i < STACKS; i++){
+		stack s;
+		if(small)
+			stack_new_small(&s, sizeof(int), 8, &malloc_allocator);
+		else
+			stack_new(&s, sizeof(int));
+		for(int j = 0; j < DEPTH; j++)
+			stack_push(&s, &j);
+		for(int j = 0; j < DEPTH; j++){
+			int x;
+			stack_pop(&s, &x);
+			check += x;
+		}
+		stack_dispose(&s);
+	}
+
+	double elapsed = now() - t0;
+	printf("%-12s %7.1f ns/stack  mallocs %ld reallocs %ld frees %ld  (check %lld)\n",
+			name, elapsed * 1e9 / STACKS,
+			stack_stats.mallocs - before.mallocs,
+			stack_stats.reallocs - before.reallocs,
+			stack_stats.frees - before.frees, check);
+}
+
+int main(void){
+	run("stack_new", 0);
+	run("small", 1);
+	return 0;
+}
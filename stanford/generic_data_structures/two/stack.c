@@ -1,43 +1,246 @@
 #include "stack.h"
+#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-void stack_new(stack *s, int elem_size){
-	assert(s->elem_size > 0);
-	s->elem_size = elem_size;
+stack_alloc_stats stack_stats;
+
+static void *stack_malloc(const allocator *a, size_t size){
+	stack_stats.mallocs++;
+	return a->alloc(a->ctx, size);
+}
+
+static void *stack_realloc(const allocator *a, void *p, size_t oldsize, size_t newsize){
+	stack_stats.reallocs++;
+	return a->resize(a->ctx, p, oldsize, newsize);
+}
+
+static void stack_free(const allocator *a, void *p, size_t size){
+	if(p == NULL)
+		return;
+	stack_stats.frees++;
+	a->release(a->ctx, p, size);
+}
+
+void stack_new(stack *s, int elemSize){
+	stack_new_alloc(s, elemSize, &malloc_allocator);
+}
+
+/* the allocator is copied into the stack, for an arena that means
+   the arena itself has to outlive the stack */
+void stack_new_alloc(stack *s, int elemSize, const allocator *a){
+	assert(elemSize > 0);
+	s->alloc = *a;
+	s->elemSize = elemSize;
 	s->loglen = 0;
 	s->alloclength = 4;
-	s->elems = malloc(4 * elem_size);
+	s->elems = stack_malloc(&s->alloc, 4 * elemSize);
 	assert(s->elems != NULL);
+	s->chunklen = s->topused = 0;
+	s->top = s->spare = NULL;
+}
+
+/* room for inlinelen elements without any malloc at all, a comes in
+   once the stack outgrows them */
+void stack_new_small(stack *s, int elemSize, int inlinelen, const allocator *a){
+	assert(elemSize > 0 && inlinelen > 0);
+	assert((size_t)inlinelen * elemSize <= STACK_INLINE_BYTES);
+	s->alloc = *a;
+	s->elemSize = elemSize;
+	s->loglen = 0;
+	s->alloclength = inlinelen;
+	s->elems = s->inlinebuf;
+	s->chunklen = s->topused = 0;
+	s->top = s->spare = NULL;
+}
+
+/* no buffer up front, the first push brings in the first chunk */
+void stack_new_segmented(stack *s, int elemSize, int chunklen, const allocator *a){
+	assert(elemSize > 0 && chunklen > 0);
+	s->alloc = *a;
+	s->elemSize = elemSize;
+	s->loglen = 0;
+	s->alloclength = 0;
+	s->elems = NULL;
+	s->chunklen = chunklen;
+	s->topused = 0;
+	s->top = s->spare = NULL;
+}
+
+static size_t stack_chunk_size(const stack *s){
+	return sizeof(stack_chunk) + (size_t)s->chunklen * s->elemSize;
 }
 
 void stack_dispose(stack *s){
+	if(s->chunklen > 0){
+		while(s->top != NULL){
+			stack_chunk *prev = s->top->prev;
+			stack_free(&s->alloc, s->top, stack_chunk_size(s));
+			s->top = prev;
+		}
+		stack_free(&s->alloc, s->spare, stack_chunk_size(s));
+		s->spare = NULL;
+		return;
+	}
 	if(s->elems == NULL){
 		perror("No memory to free");
 		return;
 	}
 
-	free(s->elems);
+	if(s->elems != s->inlinebuf)
+		stack_free(&s->alloc, s->elems, (size_t)s->alloclength * s->elemSize);
 	s->elems = NULL;
 }
 static void stack_grow(stack *s);
+static void stack_add_chunk(stack *s);
+static void stack_drop_chunk(stack *s);
 
-void stack_push(void *s, void *elemaddr){
-	if(s->loglen == s->alloclength){
-		stack_grow(s);
+void stack_push(stack *s, void *elemaddr){
+	void *target;
+	if(s->chunklen > 0){
+		if(s->top == NULL || s->topused == s->chunklen)
+			stack_add_chunk(s);
+		target = s->top->elems + s->topused * s->elemSize;
+		s->topused++;
+	}else{
+		if(s->loglen == s->alloclength){
+			stack_grow(s);
+		}
+		target = (char *)s->elems + s->loglen * s->elemSize;
 	}
-	void *target = (char *)(s->elems + (s->loglen * s->elem_size));
-	memcpy(target, elemaddr, s->elem_size);
+	memcpy(target, elemaddr, s->elemSize);
 	s->loglen++;
 }
 
+void *stack_grow_buffer(const allocator *a, void *elems, int *alloclength, int elemSize){
+	size_t oldsize = (size_t)*alloclength * elemSize;
+	*alloclength *= 2;
+	elems = stack_realloc(a, elems, oldsize, (size_t)*alloclength * elemSize);
+	assert(elems != NULL);
+	return elems;
+}
+
+/* leaving the inline buffer: first real heap block, copy over */
+static void stack_leave_inline(stack *s, int alloclength){
+	void *heap = stack_malloc(&s->alloc, (size_t)alloclength * s->elemSize);
+	assert(heap != NULL);
+	memcpy(heap, s->inlinebuf, s->loglen * s->elemSize);
+	s->elems = heap;
+	s->alloclength = alloclength;
+}
+
 static void stack_grow(stack *s){
-	s->alloclength *= 2;
-	s->elems = realloc(s->elems, s->alloclength * s->elem_size);
+	if(s->elems == s->inlinebuf)
+		stack_leave_inline(s, s->alloclength * 2);
+	else
+		s->elems = stack_grow_buffer(&s->alloc, s->elems, &s->alloclength, s->elemSize);
+}
+
+/* O(1): either reuse the spare chunk or malloc exactly one new one */
+static void stack_add_chunk(stack *s){
+	stack_chunk *chunk = s->spare;
+	if(chunk != NULL){
+		s->spare = NULL;
+	}else{
+		chunk = stack_malloc(&s->alloc, stack_chunk_size(s));
+		assert(chunk != NULL);
+		s->alloclength += s->chunklen;
+	}
+	chunk->prev = s->top;
+	s->top = chunk;
+	s->topused = 0;
+}
+
+/* the emptied top chunk becomes the spare, so push/pop going back and
+   forth over a chunk boundary doesn't malloc/free on every call */
+static void stack_drop_chunk(stack *s){
+	stack_chunk *empty = s->top;
+	s->top = empty->prev;
+	s->topused = s->chunklen;
+	if(s->spare != NULL){
+		stack_free(&s->alloc, s->spare, stack_chunk_size(s));
+		s->alloclength -= s->chunklen;
+	}
+	s->spare = empty;
 }
 
 void stack_pop(stack *s, void *elem_addr){
+	void *source;
+	assert(s->loglen > 0);
 	s->loglen--;
-	void *source = (char *)(s->elems + (s->loglen * s->elem_size));
-	memcpy(elem_addr, source, s-elem_size);
+	if(s->chunklen > 0){
+		if(s->topused == 0)
+			stack_drop_chunk(s);
+		s->topused--;
+		source = s->top->elems + s->topused * s->elemSize;
+	}else{
+		source = (char *)s->elems + s->loglen * s->elemSize;
+	}
+	memcpy(elem_addr, source, s->elemSize);
+}
+
+/* room for n elements in total, doubling like stack_grow */
+void stack_reserve(stack *s, int n){
+	if(s->chunklen > 0 || n <= s->alloclength)
+		return;
+	int alloclength = s->alloclength;
+	while(alloclength < n)
+		alloclength *= 2;
+	if(s->elems == s->inlinebuf){
+		stack_leave_inline(s, alloclength);
+		return;
+	}
+	s->elems = stack_realloc(&s->alloc, s->elems,
+			(size_t)s->alloclength * s->elemSize, (size_t)alloclength * s->elemSize);
+	s->alloclength = alloclength;
+	assert(s->elems != NULL);
+}
+
+void stack_push_n(stack *s, const void *elems, int n){
+	const char *source = elems;
+	assert(n >= 0);
+	if(s->chunklen == 0){
+		stack_reserve(s, s->loglen + n);
+		memcpy((char *)s->elems + s->loglen * s->elemSize, source, n * s->elemSize);
+		s->loglen += n;
+		return;
+	}
+	while(n > 0){
+		if(s->top == NULL || s->topused == s->chunklen)
+			stack_add_chunk(s);
+		int room = s->chunklen - s->topused;
+		int count = n < room ? n : room;
+		memcpy(s->top->elems + s->topused * s->elemSize, source, count * s->elemSize);
+		s->topused += count;
+		s->loglen += count;
+		source += count * s->elemSize;
+		n -= count;
+	}
+}
+
+/* count elements from src, top (highest address) first, into target */
+static void stack_copy_reversed(char *target, const char *src, int count, int elemSize){
+	for(int i = count - 1; i >= 0; i--, target += elemSize)
+		memcpy(target, src + i * elemSize, elemSize);
+}
+
+void stack_pop_n(stack *s, void *elems, int n){
+	assert(n >= 0 && s->loglen >= n);
+	s->loglen -= n;
+	if(s->chunklen == 0){
+		stack_copy_reversed(elems, (char *)s->elems + s->loglen * s->elemSize, n, s->elemSize);
+		return;
+	}
+	/* walk down from the top, filling the output from its start */
+	char *target = elems;
+	while(n > 0){
+		if(s->topused == 0)
+			stack_drop_chunk(s);
+		int count = n < s->topused ? n : s->topused;
+		s->topused -= count;
+		stack_copy_reversed(target, s->top->elems + s->topused * s->elemSize, count, s->elemSize);
+		target += count * s->elemSize;
+		n -= count;
+	}
 }
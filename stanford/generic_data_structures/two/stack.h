@@ -1,14 +1,57 @@
 #ifndef STACK_H
 #define STACK_H
 
+#include "../allocator.h"
+
+/* segmented mode keeps the elements in a linked list of fixed size
+   chunks, growing never moves (or copies) what is already stored */
+typedef struct stack_chunk{
+	struct stack_chunk *prev;
+	char elems[];
+}stack_chunk;
+
+/* small buffer mode: the first few elements live inside the struct
+   itself (elems == inlinebuf) and the heap is only touched once they
+   overflow. Such a stack must not be copied or moved while in use. */
+#ifndef STACK_INLINE_BYTES
+#define STACK_INLINE_BYTES 64
+#endif
+
 typedef struct{
 	void *elems;
 	int elemSize, loglen, alloclength;
+	int chunklen, topused;		/* chunklen == 0 -> one contiguous buffer */
+	allocator alloc;		/* where every buffer and chunk comes from */
+	stack_chunk *top, *spare;	/* spare: one empty chunk kept around */
+	_Alignas(16) char inlinebuf[STACK_INLINE_BYTES];
 }stack;
 
+/* every alloc/resize/release done by stack.c, to see what the small
+   buffer mode saves. Not thread safe, like the rest of stack.c */
+typedef struct{
+	long mallocs, reallocs, frees;
+}stack_alloc_stats;
+
+extern stack_alloc_stats stack_stats;
+
 void stack_new(stack *s, int elemSize);
+void stack_new_alloc(stack *s, int elemSize, const allocator *a);
+void stack_new_small(stack *s, int elemSize, int inlinelen, const allocator *a);
+void stack_new_segmented(stack *s, int elemSize, int chunklen, const allocator *a);
 void stack_dispose(stack *s);
 void stack_push(stack *s, void *elem_addr);
 void stack_pop(stack *s, void *elem_addr);
-#endif
 
+/* batch versions, one capacity check. stack_push_n is one memcpy (one
+   per chunk in segmented mode); stack_pop_n hands the elements out top
+   first, same as n stack_pop calls would, so push_n(a, n) then
+   pop_n(b, n) leaves b reversed.
+   stack_reserve is a no-op for segmented stacks, they never copy anyway */
+void stack_reserve(stack *s, int n);
+void stack_push_n(stack *s, const void *elems, int n);
+void stack_pop_n(stack *s, void *elems, int n);
+
+/* the doubling step on its own, shared with the typed stacks in
+   typed_stack.h. Returns the new buffer, *alloclength is updated */
+void *stack_grow_buffer(const allocator *a, void *elems, int *alloclength, int elemSize);
+#endif
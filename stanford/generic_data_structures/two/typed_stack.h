@@ -0,0 +1,55 @@
+#ifndef TYPED_STACK_H
+#define TYPED_STACK_H
+
+#include <assert.h>
+#include <stdlib.h>
+#include "stack.h"
+
+/* The generic stack carries elemSize around at runtime and memcpy's
+   every element. DEFINE_STACK stamps out a stack for one type instead,
+   so sizeof(type) is a constant and push/pop are plain assignments the
+   compiler can keep in registers.
+
+	DEFINE_STACK(int_stack, int)
+
+	int_stack s;
+	int_stack_new(&s);
+	int_stack_push(&s, 42);
+	int x = int_stack_pop(&s);
+	int_stack_dispose(&s);
+
+   Growth is the same doubling as stack.c (stack_grow_buffer), kept out
+   of line since it is the rare path.
+ */
+
+#define DEFINE_STACK(name, type)					\
+typedef struct{								\
+	type *elems;							\
+	int loglen, alloclength;					\
+}name;									\
+									\
+static inline void name##_new(name *s){					\
+	s->loglen = 0;							\
+	s->alloclength = 4;						\
+	s->elems = malloc(4 * sizeof(type));				\
+	assert(s->elems != NULL);					\
+}									\
+									\
+static inline void name##_dispose(name *s){				\
+	free(s->elems);							\
+	s->elems = NULL;						\
+}									\
+									\
+static inline void name##_push(name *s, type value){			\
+	if(s->loglen == s->alloclength)					\
+		s->elems = stack_grow_buffer(&malloc_allocator,		\
+			s->elems, &s->alloclength, sizeof(type));	\
+	s->elems[s->loglen++] = value;					\
+}									\
+									\
+static inline type name##_pop(name *s){					\
+	assert(s->loglen > 0);						\
+	return s->elems[--s->loglen];					\
+}
+
+#endif
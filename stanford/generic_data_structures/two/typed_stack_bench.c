@@ -0,0 +1,103 @@
+/* DEFINE_STACK(int_stack, int) against the generic stack (elemSize +
+   memcpy) and the hand written int stack from ../one.
+
+   gcc -O2 typed_stack_bench.c stack.c ../allocator.c -o typed_stack_bench
+ */
+#include <stdio.h>
+#include <time.h>
+
+/* the int stack in ../one uses the same names as the generic one,
+   pull it in under one_ prefixed names */
+#define stack one_stack
+#define stack_new one_stack_new
+#define stack_new_small one_stack_new_small
+#define stack_stats one_stack_stats
+#define stack_alloc_stats one_stack_alloc_stats
+#define stack_dispose one_stack_dispose
+#define stack_push one_stack_push
+#define stack_pop one_stack_pop
+#define stack_reserve one_stack_reserve
+#define stack_push_n one_stack_push_n
+#define stack_pop_n one_stack_pop_n
+#include "../one/stack.c"
+#undef stack
+#undef stack_new
+#undef stack_new_small
+#undef stack_stats
+#undef stack_alloc_stats
+#undef stack_dispose
+#undef stack_push
+#undef stack_pop
+#undef stack_reserve
+#undef stack_push_n
+#undef stack_pop_n
+#undef STACK_H
+
+#include "stack.h"
+#include "typed_stack.h"
+
+DEFINE_STACK(int_stack, int)
+
+#define N (1 << 20)
+#define ROUNDS 50
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double seconds, long long check){
+	printf("%-16s %6.3f ns/op   (check %lld)\n", name,
+			seconds * 1e9 / (2.0 * N * ROUNDS), check);
+}
+
+int main(void){
+	long long check;
+	double t0;
+
+	stack generic;
+	stack_new(&generic, sizeof(int));
+	stack_reserve(&generic, N);
+	check = 0;
+	t0 = now();
+	for(int r = 0; r < ROUNDS; r++){
+		for(int i = 0; i < N; i++)
+			stack_push(&generic, &i);
+		for(int i = 0; i < N; i++){
+			int x;
+			stack_pop(&generic, &x);
+			check += x;
+		}
+	}
+	report("generic stack", now() - t0, check);
+	stack_dispose(&generic);
+
+	one_stack hand;
+	one_stack_new(&hand);
+	one_stack_reserve(&hand, N);
+	check = 0;
+	t0 = now();
+	for(int r = 0; r < ROUNDS; r++){
+		for(int i = 0; i < N; i++)
+			one_stack_push(&hand, i);
+		for(int i = 0; i < N; i++)
+			check += one_stack_pop(&hand);
+	}
+	report("one/ int stack", now() - t0, check);
+	one_stack_dispose(&hand);
+
+	int_stack typed;
+	int_stack_new(&typed);
+	check = 0;
+	t0 = now();
+	for(int r = 0; r < ROUNDS; r++){
+		for(int i = 0; i < N; i++)
+			int_stack_push(&typed, i);
+		for(int i = 0; i < N; i++)
+			check += int_stack_pop(&typed);
+	}
+	report("DEFINE_STACK", now() - t0, check);
+	int_stack_dispose(&typed);
+	return 0;
+}
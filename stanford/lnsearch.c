@@ -1,32 +1,8 @@
 #include <stdio.h>
 #include <string.h>
-/* There is these bullt in in c
-   bsearch(void *key, void *base, int n, int elemsize, int (*cmp)(void *, void *));
- */
+#include "lsearch.h"
 
-
-void *lsearch(void *key,void *base, int n, int elemsize, int (*cmpfn)(void *, void *)){
-    for (int i = 0; i < n; i++){
-	void *elemadrr = (char*)base + i * elemsize;
-	if(cmpfn(key, elemadrr) == 0)
-	    return elemadrr;
-    }	
-    return NULL;
-}
-
-int intCmp(void *vp1, void *vp2){
-    int *ip1 = vp1;
-    int *ip2 = vp2;
-
-    return *ip1 - *ip2;
-}
-
-
-int StrCmp(void *vp1, void *vp2){
-    char *s1 = *(char **)vp1;
-    char *s2 = *(char **)vp2;
-    return strcmp(s1, s2);
-}
+/* gcc lnsearch.c lsearch.c lsearch_simd.c -o lnsearch */
 
 int main(void)
 {
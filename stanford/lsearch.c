@@ -0,0 +1,54 @@
+#include <stdint.h>
+#include <string.h>
+#include "lsearch.h"
+#include "lsearch_simd.h"
+
+static void *lsearch_cmp(void *key, void *base, int n, int elemsize, int (*cmpfn)(void *, void *)){
+    for (int i = 0; i < n; i++){
+	void *elemadrr = (char*)base + i * elemsize;
+	if(cmpfn(key, elemadrr) == 0)
+	    return elemadrr;
+    }
+    return NULL;
+}
+
+void *lsearch(void *key,void *base, int n, int elemsize, int (*cmpfn)(void *, void *)){
+    int width = 0;
+    if(cmpfn == charCmp) width = 1;
+    else if(cmpfn == shortCmp) width = 2;
+    else if(cmpfn == intCmp) width = 4;
+    else if(cmpfn == longCmp) width = 8;
+
+    if(width != 0 && width == elemsize)
+	return lsearch_simd_find(width)(key, base, n);
+    return lsearch_cmp(key, base, n, elemsize, cmpfn);
+}
+
+int charCmp(void *vp1, void *vp2){
+    return *(char *)vp1 - *(char *)vp2;
+}
+
+int shortCmp(void *vp1, void *vp2){
+    return *(short *)vp1 - *(short *)vp2;
+}
+
+int intCmp(void *vp1, void *vp2){
+    int *ip1 = vp1;
+    int *ip2 = vp2;
+
+    return *ip1 - *ip2;
+}
+
+/* 8 bytes whatever long is, a plain difference would not fit in int */
+int longCmp(void *vp1, void *vp2){
+    int64_t l1 = *(int64_t *)vp1;
+    int64_t l2 = *(int64_t *)vp2;
+    return (l1 > l2) - (l1 < l2);
+}
+
+
+int StrCmp(void *vp1, void *vp2){
+    char *s1 = *(char **)vp1;
+    char *s2 = *(char **)vp2;
+    return strcmp(s1, s2);
+}
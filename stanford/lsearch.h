@@ -0,0 +1,25 @@
+#ifndef LSEARCH_H
+#define LSEARCH_H
+
+/* There is these bullt in in c
+   bsearch(void *key, void *base, int n, int elemsize, int (*cmp)(void *, void *));
+ */
+void *lsearch(void *key, void *base, int n, int elemsize, int (*cmpfn)(void *, void *));
+
+/* equality style comparators lsearch knows about, with one of these
+   (and the matching elemsize) it skips the function pointer and runs
+   a SIMD kernel from lsearch_simd.c */
+int charCmp(void *vp1, void *vp2);
+int shortCmp(void *vp1, void *vp2);
+int intCmp(void *vp1, void *vp2);
+int longCmp(void *vp1, void *vp2);
+
+int StrCmp(void *vp1, void *vp2);
+
+/* lsearch split over several threads (parallel_lsearch.c). Gives the
+   lowest matching element, same as lsearch would. Below the threshold
+   it just calls lsearch, threads aren't worth it there.
+   nthreads 0 means one per online CPU */
+void *parallel_lsearch(void *key, void *base, int n, int elemsize, int (*cmpfn)(void *, void *));
+void parallel_lsearch_config(int nthreads, int threshold);
+#endif
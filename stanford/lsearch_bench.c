@@ -0,0 +1,73 @@
+/* lsearch through the cmpfn pointer against the SIMD kernels for
+   int keys, 16 .. 10M elements. The key is not in the array so every
+   search is a full scan.
+
+   gcc -O2 lsearch_bench.c lsearch.c lsearch_simd.c -o lsearch_bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lsearch.h"
+#include "lsearch_simd.h"
+
+#define WORK 400000000L     /* elements scanned per measurement */
+
+/* same as intCmp but lsearch doesn't recognize it -> old path */
+static int plainIntCmp(void *vp1, void *vp2){
+    return *(int *)vp1 - *(int *)vp2;
+}
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* ns per element for one way of searching */
+static double measure(int *array, int n, lsearch_kernel kernel){
+    int key = -1;
+    long rounds = WORK / n;
+    long found = 0;
+    if(rounds == 0)
+	rounds = 1;
+    double t0 = now();
+    for (long r = 0; r < rounds; r++){
+	if(kernel != NULL)
+	    found += kernel(&key, array, n) != NULL;
+	else
+	    found += lsearch(&key, array, n, sizeof(int), plainIntCmp) != NULL;
+    }
+    double elapsed = now() - t0;
+    if(found != 0)
+	printf("?? found a key that isn't there\n");
+    return elapsed * 1e9 / ((double)rounds * n);
+}
+
+int main(void){
+    const char *names[] = { "scalar", "sse2", "avx2" };
+    int max = 10000000;
+    int *array = malloc(max * sizeof(int));
+    for (int i = 0; i < max; i++)
+	array[i] = i;
+
+    printf("%10s %10s", "n", "cmpfn");
+    for (int level = LSEARCH_SCALAR; level <= LSEARCH_AVX2; level++)
+	printf(" %10s", names[level]);
+    printf("   (ns/element)\n");
+
+    int sizes[] = { 16, 64, 256, 1024, 16384, 262144, 1048576, 10000000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+	int n = sizes[s];
+	printf("%10d %10.3f", n, measure(array, n, NULL));
+	for (int level = LSEARCH_SCALAR; level <= LSEARCH_AVX2; level++){
+	    lsearch_kernel k = lsearch_simd_kernel(sizeof(int), level);
+	    if(k == NULL)
+		printf(" %10s", "-");
+	    else
+		printf(" %10.3f", measure(array, n, k));
+	}
+	printf("\n");
+    }
+    free(array);
+    return 0;
+}
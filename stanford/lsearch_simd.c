@@ -0,0 +1,151 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "lsearch_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LSEARCH_X86 1
+#endif
+
+/* The kernels compare a whole block (4 vectors) per iteration and OR
+   the results together, only a block that has a hit gets looked at
+   element by element. The scalar loop handles the tail and is the
+   fallback everywhere else. */
+
+#define SCALAR_KERNEL(name, type)                                       \
+static void *name(const void *key, const void *base, int n){            \
+    type k = *(const type *)key;                                        \
+    const type *p = base;                                               \
+    for (int i = 0; i < n; i++)                                         \
+	if(p[i] == k)                                                   \
+	    return (void *)(p + i);                                     \
+    return NULL;                                                        \
+}
+
+SCALAR_KERNEL(scalar8, uint8_t)
+SCALAR_KERNEL(scalar16, uint16_t)
+SCALAR_KERNEL(scalar32, uint32_t)
+SCALAR_KERNEL(scalar64, uint64_t)
+
+#ifdef LSEARCH_X86
+
+/* SSE2: 16 bytes per vector, 4 vectors per block */
+#define SSE2_KERNEL(name, type, tail, set1, cmpeq)                      \
+__attribute__((target("sse2")))                                         \
+static void *name(const void *key, const void *base, int n){            \
+    const int per = 64 / sizeof(type);                                  \
+    const type *p = base;                                               \
+    __m128i k = set1(*(const type *)key);                               \
+    int i = 0;                                                          \
+    for (; i + per <= n; i += per){                                     \
+	const __m128i *v = (const __m128i *)(p + i);                    \
+	__m128i hit = _mm_or_si128(                                     \
+	    _mm_or_si128(cmpeq(_mm_loadu_si128(v), k),                  \
+			 cmpeq(_mm_loadu_si128(v + 1), k)),             \
+	    _mm_or_si128(cmpeq(_mm_loadu_si128(v + 2), k),              \
+			 cmpeq(_mm_loadu_si128(v + 3), k)));            \
+	if(_mm_movemask_epi8(hit))                                      \
+	    return tail(key, p + i, per);                               \
+    }                                                                   \
+    return tail(key, p + i, n - i);                                     \
+}
+
+/* SSE2 has no 64 bit compare: both 32 bit halves have to match */
+__attribute__((target("sse2")))
+static inline __m128i sse2_cmpeq64(__m128i a, __m128i b){
+    __m128i eq = _mm_cmpeq_epi32(a, b);
+    return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_set64(uint64_t x){
+    return _mm_set1_epi64x((long long)x);
+}
+
+SSE2_KERNEL(sse2_8, uint8_t, scalar8, _mm_set1_epi8, _mm_cmpeq_epi8)
+SSE2_KERNEL(sse2_16, uint16_t, scalar16, _mm_set1_epi16, _mm_cmpeq_epi16)
+SSE2_KERNEL(sse2_32, uint32_t, scalar32, _mm_set1_epi32, _mm_cmpeq_epi32)
+SSE2_KERNEL(sse2_64, uint64_t, scalar64, sse2_set64, sse2_cmpeq64)
+
+/* AVX2: 32 bytes per vector, 4 vectors per block */
+#define AVX2_KERNEL(name, type, tail, set1, cmpeq)                      \
+__attribute__((target("avx2")))                                         \
+static void *name(const void *key, const void *base, int n){            \
+    const int per = 128 / sizeof(type);                                 \
+    const type *p = base;                                               \
+    __m256i k = set1(*(const type *)key);                               \
+    int i = 0;                                                          \
+    for (; i + per <= n; i += per){                                     \
+	const __m256i *v = (const __m256i *)(p + i);                    \
+	__m256i hit = _mm256_or_si256(                                  \
+	    _mm256_or_si256(cmpeq(_mm256_loadu_si256(v), k),            \
+			    cmpeq(_mm256_loadu_si256(v + 1), k)),       \
+	    _mm256_or_si256(cmpeq(_mm256_loadu_si256(v + 2), k),        \
+			    cmpeq(_mm256_loadu_si256(v + 3), k)));      \
+	if(_mm256_movemask_epi8(hit))                                   \
+	    return tail(key, p + i, per);                               \
+    }                                                                   \
+    return tail(key, p + i, n - i);                                     \
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_set64(uint64_t x){
+    return _mm256_set1_epi64x((long long)x);
+}
+
+AVX2_KERNEL(avx2_8, uint8_t, scalar8, _mm256_set1_epi8, _mm256_cmpeq_epi8)
+AVX2_KERNEL(avx2_16, uint16_t, scalar16, _mm256_set1_epi16, _mm256_cmpeq_epi16)
+AVX2_KERNEL(avx2_32, uint32_t, scalar32, _mm256_set1_epi32, _mm256_cmpeq_epi32)
+AVX2_KERNEL(avx2_64, uint64_t, scalar64, avx2_set64, _mm256_cmpeq_epi64)
+
+#endif
+
+static int width_slot(int width){
+    switch(width){
+	case 1: return 0;
+	case 2: return 1;
+	case 4: return 2;
+	case 8: return 3;
+    }
+    return -1;
+}
+
+lsearch_kernel lsearch_simd_kernel(int width, int level){
+    static const lsearch_kernel scalar[] = { scalar8, scalar16, scalar32, scalar64 };
+    int slot = width_slot(width);
+    if(slot < 0)
+	return NULL;
+    if(level == LSEARCH_SCALAR)
+	return scalar[slot];
+#ifdef LSEARCH_X86
+    static const lsearch_kernel sse2[] = { sse2_8, sse2_16, sse2_32, sse2_64 };
+    static const lsearch_kernel avx2[] = { avx2_8, avx2_16, avx2_32, avx2_64 };
+    __builtin_cpu_init();
+    if(level == LSEARCH_SSE2 && __builtin_cpu_supports("sse2"))
+	return sse2[slot];
+    if(level == LSEARCH_AVX2 && __builtin_cpu_supports("avx2"))
+	return avx2[slot];
+#endif
+    return NULL;
+}
+
+/* picked once, lsearch calls this on every search */
+static lsearch_kernel best[4];
+
+__attribute__((constructor))
+static void lsearch_simd_init(void){
+    for (int slot = 0; slot < 4; slot++){
+	int width = 1 << slot;
+	lsearch_kernel k = lsearch_simd_kernel(width, LSEARCH_AVX2);
+	if(k == NULL)
+	    k = lsearch_simd_kernel(width, LSEARCH_SSE2);
+	if(k == NULL)
+	    k = lsearch_simd_kernel(width, LSEARCH_SCALAR);
+	best[slot] = k;
+    }
+}
+
+lsearch_kernel lsearch_simd_find(int width){
+    int slot = width_slot(width);
+    return slot < 0 ? NULL : best[slot];
+}
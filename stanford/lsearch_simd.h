@@ -0,0 +1,14 @@
+#ifndef LSEARCH_SIMD_H
+#define LSEARCH_SIMD_H
+
+/* linear search for a 1, 2, 4 or 8 byte key by plain equality.
+   Returns the address of the first match like lsearch, or NULL */
+typedef void *(*lsearch_kernel)(const void *key, const void *base, int n);
+
+enum { LSEARCH_SCALAR, LSEARCH_SSE2, LSEARCH_AVX2 };
+
+/* the best kernel this CPU can run (checked once via CPUID) */
+lsearch_kernel lsearch_simd_find(int width);
+/* one particular level, NULL if the CPU (or the build) can't do it */
+lsearch_kernel lsearch_simd_kernel(int width, int level);
+#endif
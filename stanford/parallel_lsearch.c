@@ -0,0 +1,87 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include "lsearch.h"
+
+/* Each thread gets one contiguous slice and walks it in blocks. After a
+   hit the lowest index found so far is published in best, and a thread
+   whose next block starts past it has nothing left to win and stops.
+   So a hit early in the array cancels most of the work. */
+
+#define MAXTHREADS 256
+#define BLOCK 16384         /* elements between two looks at best */
+
+static int config_threads = 0;
+static int config_threshold = 1 << 18;
+
+void parallel_lsearch_config(int nthreads, int threshold){
+    config_threads = nthreads;
+    config_threshold = threshold;
+}
+
+typedef struct{
+    void *key;
+    char *base;
+    int elemsize;
+    int (*cmpfn)(void *, void *);
+    atomic_int best;        /* lowest matching index, n if none yet */
+}search_job;
+
+typedef struct{
+    search_job *job;
+    int begin, end;
+    int started;
+    pthread_t thread;
+}search_slice;
+
+static void *search_worker(void *arg){
+    search_slice *slice = arg;
+    search_job *job = slice->job;
+
+    for (int i = slice->begin; i < slice->end; i += BLOCK){
+	if(i >= atomic_load_explicit(&job->best, memory_order_relaxed))
+	    break;
+	int count = slice->end - i < BLOCK ? slice->end - i : BLOCK;
+	char *hit = lsearch(job->key, job->base + (long)i * job->elemsize,
+			    count, job->elemsize, job->cmpfn);
+	if(hit != NULL){
+	    int index = (hit - job->base) / job->elemsize;
+	    int best = atomic_load(&job->best);
+	    while(index < best && !atomic_compare_exchange_weak(&job->best, &best, index))
+		;
+	    break;
+	}
+    }
+    return NULL;
+}
+
+void *parallel_lsearch(void *key, void *base, int n, int elemsize, int (*cmpfn)(void *, void *)){
+    int nthreads = config_threads > 0 ? config_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(nthreads > MAXTHREADS)
+	nthreads = MAXTHREADS;
+    if(n < config_threshold || nthreads <= 1)
+	return lsearch(key, base, n, elemsize, cmpfn);
+
+    search_job job = { .key = key, .base = base, .elemsize = elemsize, .cmpfn = cmpfn };
+    search_slice slices[MAXTHREADS];
+    atomic_init(&job.best, n);
+
+    /* slice 0 runs on the calling thread */
+    for (int t = 0; t < nthreads; t++){
+	slices[t].job = &job;
+	slices[t].begin = (long)n * t / nthreads;
+	slices[t].end = (long)n * (t + 1) / nthreads;
+	slices[t].started = t > 0 &&
+	    pthread_create(&slices[t].thread, NULL, search_worker, &slices[t]) == 0;
+	/* out of threads, the caller picks up this slice itself */
+	if(t > 0 && !slices[t].started)
+	    search_worker(&slices[t]);
+    }
+    search_worker(&slices[0]);
+    for (int t = 1; t < nthreads; t++)
+	if(slices[t].started)
+	    pthread_join(slices[t].thread, NULL);
+
+    int best = atomic_load(&job.best);
+    return best < n ? (char *)base + (long)best * elemsize : NULL;
+}
@@ -0,0 +1,62 @@
+/* parallel_lsearch from 1 thread up to every core, over a big unsorted
+   int array. The key sits in the last element so the whole array gets
+   scanned. ./plsearch_bench [elements]
+
+   gcc -O2 -pthread plsearch_bench.c parallel_lsearch.c lsearch.c lsearch_simd.c -o plsearch_bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "lsearch.h"
+
+#define ROUNDS 5
+
+/* not one of the comparators lsearch recognizes, so every element goes
+   through the function pointer like with any other type */
+static int plainIntCmp(void *vp1, void *vp2){
+	return *(int *)vp1 - *(int *)vp2;
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(int *array, int n, int (*cmpfn)(void *, void *)){
+	int key = -1;
+	double t0 = now();
+	for(int r = 0; r < ROUNDS; r++){
+		int *hit = parallel_lsearch(&key, array, n, sizeof(int), cmpfn);
+		if(hit != array + n - 1)
+			printf("?? wrong hit\n");
+	}
+	return (now() - t0) / ROUNDS;
+}
+
+int main(int argc, char *argv[]){
+	int n = argc > 1 ? atoi(argv[1]) : 200000000;
+	int cores = sysconf(_SC_NPROCESSORS_ONLN);
+	int *array = malloc((size_t)n * sizeof(int));
+	if(array == NULL){
+		fprintf(stderr, "no memory for %d ints\n", n);
+		return EXIT_FAILURE;
+	}
+	for(int i = 0; i < n; i++)
+		array[i] = rand();	/* never negative */
+	array[n - 1] = -1;
+
+	printf("%8s %14s %14s\n", "threads", "cmpfn GB/s", "intCmp GB/s");
+	for(int t = 1; ; t = t * 2 > cores && t != cores ? cores : t * 2){
+		parallel_lsearch_config(t, 1 << 18);
+		double plain = run(array, n, plainIntCmp);
+		double simd = run(array, n, intCmp);
+		double bytes = (double)n * sizeof(int);
+		printf("%8d %14.2f %14.2f\n", t, bytes / plain / 1e9, bytes / simd / 1e9);
+		if(t == cores)
+			break;
+	}
+	free(array);
+	return 0;
+}
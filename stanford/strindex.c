@@ -0,0 +1,60 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "strindex.h"
+
+uint32_t strindex_hash(const char *s){
+	uint64_t h = 0xcbf29ce484222325ULL;
+	while(*s){
+		h ^= (unsigned char)*s++;
+		h *= 0x100000001b3ULL;
+	}
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+/* load factor stays at or below 1/2 */
+void strindex_build(strindex *ix, char **base, int n){
+	uint32_t slots = 16;
+	while(slots < 2u * (uint32_t)n)
+		slots *= 2;
+
+	ix->base = base;
+	ix->n = n;
+	ix->mask = slots - 1;
+	ix->slots = malloc(slots * sizeof(strindex_slot));
+	assert(ix->slots != NULL);
+	for(uint32_t i = 0; i < slots; i++)
+		ix->slots[i].index = -1;
+
+	for(int i = 0; i < n; i++){
+		uint32_t hash = strindex_hash(base[i]);
+		uint32_t at = hash & ix->mask;
+		while(ix->slots[at].index != -1){
+			strindex_slot *slot = &ix->slots[at];
+			if(slot->hash == hash && strcmp(base[slot->index], base[i]) == 0)
+				break;		/* duplicate, the earlier one wins */
+			at = (at + 1) & ix->mask;
+		}
+		if(ix->slots[at].index == -1){
+			ix->slots[at].hash = hash;
+			ix->slots[at].index = i;
+		}
+	}
+}
+
+char **strindex_find(const strindex *ix, const char *key){
+	uint32_t hash = strindex_hash(key);
+	uint32_t at = hash & ix->mask;
+	while(ix->slots[at].index != -1){
+		const strindex_slot *slot = &ix->slots[at];
+		if(slot->hash == hash && strcmp(ix->base[slot->index], key) == 0)
+			return &ix->base[slot->index];
+		at = (at + 1) & ix->mask;
+	}
+	return NULL;
+}
+
+void strindex_dispose(strindex *ix){
+	free(ix->slots);
+	ix->slots = NULL;
+}
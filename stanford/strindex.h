@@ -0,0 +1,32 @@
+#ifndef STRINDEX_H
+#define STRINDEX_H
+
+#include <stdint.h>
+
+/* Open addressing hash index over an existing char *[] (the strings are
+   not copied, the array has to stay put). A lookup gives back the same
+   char ** that lsearch(&key, base, n, sizeof(char *), StrCmp) would,
+   the first one if a string is in there twice.
+
+   Every slot keeps the 32 bit hash next to the array index, so a probe
+   only calls strcmp when the hashes already match. */
+
+typedef struct{
+	uint32_t hash;
+	int32_t index;		/* into base, -1 for an empty slot */
+}strindex_slot;
+
+typedef struct{
+	char **base;
+	int n;
+	uint32_t mask;		/* slots - 1, slots is a power of two */
+	strindex_slot *slots;
+}strindex;
+
+void strindex_build(strindex *ix, char **base, int n);
+char **strindex_find(const strindex *ix, const char *key);
+void strindex_dispose(strindex *ix);
+
+/* 64 bit FNV-1a folded to 32 bits */
+uint32_t strindex_hash(const char *s);
+#endif
@@ -0,0 +1,88 @@
+/* symbol table lookups: lsearch + StrCmp, binsearch over a sorted copy
+   and strindex, for tables from 1K to 1M strings. Half the keys are in
+   the table.
+
+   gcc -O2 strindex_bench.c strindex.c binsearch.c lsearch.c lsearch_simd.c -o strindex_bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "binsearch.h"
+#include "lsearch.h"
+#include "strindex.h"
+
+#define QUERIES 200000
+#define LINEAR_WORK 400000000L	/* cap on strcmp calls for lsearch */
+
+static int qsortStrCmp(const void *vp1, const void *vp2){
+	return strcmp(*(char * const *)vp1, *(char * const *)vp2);
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *symbol(int i){
+	char buf[32];
+	snprintf(buf, sizeof(buf), "sym_%08x_%d", (unsigned)(i * 2654435761u), i);
+	return strdup(buf);
+}
+
+int main(void){
+	int sizes[] = { 1000, 10000, 100000, 1000000 };
+	char **keys = malloc(QUERIES * sizeof(char *));
+
+	printf("%10s %14s %14s %14s   (ns/lookup)\n", "n", "lsearch", "binsearch", "strindex");
+	for(int s = 0; s < 4; s++){
+		int n = sizes[s];
+		char **table = malloc(n * sizeof(char *));
+		char **sorted = malloc(n * sizeof(char *));
+		for(int i = 0; i < n; i++)
+			table[i] = symbol(i);
+		memcpy(sorted, table, n * sizeof(char *));
+		qsort(sorted, n, sizeof(char *), qsortStrCmp);
+		/* odd i -> a symbol that is not in the table */
+		for(int q = 0; q < QUERIES; q++)
+			keys[q] = symbol(q & 1 ? n + q : rand() % n);
+
+		strindex ix;
+		strindex_build(&ix, table, n);
+
+		long linear_queries = LINEAR_WORK / n < QUERIES ? LINEAR_WORK / n : QUERIES;
+		long found[3] = { 0, 0, 0 };
+		double t0 = now();
+		for(long q = 0; q < linear_queries; q++)
+			found[0] += lsearch(&keys[q], table, n, sizeof(char *), StrCmp) != NULL;
+		double linear = (now() - t0) * 1e9 / linear_queries;
+
+		t0 = now();
+		for(int q = 0; q < QUERIES; q++)
+			found[1] += binsearch(&keys[q], sorted, n, sizeof(char *), StrCmp) != NULL;
+		double binary = (now() - t0) * 1e9 / QUERIES;
+
+		t0 = now();
+		for(int q = 0; q < QUERIES; q++)
+			found[2] += strindex_find(&ix, keys[q]) != NULL;
+		double hashed = (now() - t0) * 1e9 / QUERIES;
+
+		for(int q = 0; q < 100; q++)
+			if(strindex_find(&ix, keys[q]) != lsearch(&keys[q], table, n, sizeof(char *), StrCmp))
+				printf("?? strindex and lsearch disagree on %s\n", keys[q]);
+
+		printf("%10d %14.1f %14.1f %14.1f   (hits %ld/%ld %ld %ld)\n", n,
+				linear, binary, hashed, found[0], linear_queries, found[1], found[2]);
+
+		strindex_dispose(&ix);
+		for(int i = 0; i < n; i++)
+			free(table[i]);
+		for(int q = 0; q < QUERIES; q++)
+			free(keys[q]);
+		free(table);
+		free(sorted);
+	}
+	free(keys);
+	return 0;
+}
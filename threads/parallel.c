@@ -0,0 +1,144 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "parallel.h"
+
+#define CACHE_LINE 64
+#define MAX_SPLITS 64
+#define STEAL_SPLITS 2          /* extra halvings for a piece that was stolen */
+#define CHUNKS_PER_WORKER 16
+#define ROOT -2
+
+static pool *shared, *chosen;
+static pthread_once_t shared_once = PTHREAD_ONCE_INIT;
+
+static void make_shared(void){
+	shared = pool_create(0, 1);
+}
+
+/* NULL if there is no pool to be had, then everything runs serially */
+static pool *current(void){
+	if(chosen)
+		return chosen;
+	pthread_once(&shared_once, make_shared);
+	return shared;
+}
+
+void parallel_use_pool(pool *p){
+	chosen = p;
+}
+
+typedef struct{
+	pool *p;
+	parallel_body fn;
+	void *ctx;
+	long grain;
+}for_job;
+
+typedef struct{
+	const for_job *job;
+	long begin, end;
+	int splits;             /* how many more times it may be halved */
+	int cut_by;             /* the worker that split it off */
+}piece;
+
+static void *run_piece(void *arg){
+	piece *pc = arg;
+	const for_job *job = pc->job;
+	int me = pool_worker_index(job->p);
+	int splits = pc->splits;
+	if(pc->cut_by != ROOT && pc->cut_by != me)
+		splits += STEAL_SPLITS;
+
+	/* keep the left half, hand out the right one */
+	pool_task tasks[MAX_SPLITS];
+	piece halves[MAX_SPLITS];
+	int n = 0;
+	long begin = pc->begin, end = pc->end;
+	while(end - begin > job->grain && splits > 0 && n < MAX_SPLITS){
+		long mid = begin + (end - begin) / 2;
+		splits--;
+		halves[n] = (piece){ job, mid, end, splits, me };
+		pool_spawn(job->p, &tasks[n], run_piece, &halves[n]);
+		n++;
+		end = mid;
+	}
+	job->fn(begin, end, job->ctx);
+	while(n > 0)
+		pool_join(job->p, &tasks[--n]);
+	return NULL;
+}
+
+static int log2_ceil(int n){
+	int k = 0;
+	while((1 << k) < n)
+		k++;
+	return k;
+}
+
+void parallel_for(long begin, long end, long grain, parallel_body fn, void *ctx){
+	if(grain < 1)
+		grain = 1;
+	pool *p = end - begin > grain ? current() : NULL;
+	if(p == NULL){
+		if(end > begin)
+			fn(begin, end, ctx);
+		return;
+	}
+	for_job job = { p, fn, ctx, grain };
+	piece root = { &job, begin, end, log2_ceil(4 * pool_size(p)), ROOT };
+	if(pool_worker_index(p) >= 0)
+		run_piece(&root);
+	else{
+		pool_task t;
+		pool_spawn(p, &t, run_piece, &root);
+		pool_join(p, &t);
+	}
+}
+
+typedef struct{
+	long begin, end, chunk;
+	parallel_reduce_body body;
+	void *ctx;
+	const void *identity;   /* the caller's *result, untouched until the end */
+	size_t size;
+	char *slots;            /* chunk c's partial result at c * stride */
+	size_t stride;
+}reduce_job;
+
+static void reduce_chunks(long first, long last, void *arg){
+	reduce_job *job = arg;
+	for (long c = first; c < last; c++){
+		void *acc = job->slots + c * job->stride;
+		long b = job->begin + c * job->chunk;
+		long e = b + job->chunk < job->end ? b + job->chunk : job->end;
+		memcpy(acc, job->identity, job->size);
+		job->body(b, e, acc, job->ctx);
+	}
+}
+
+void parallel_reduce(long begin, long end, long grain, void *result, size_t size,
+		     parallel_reduce_body body, parallel_combine combine, void *ctx){
+	if(grain < 1)
+		grain = 1;
+	pool *p = end - begin > grain ? current() : NULL;
+	long n = end - begin;
+	long most = p ? (long)pool_size(p) * CHUNKS_PER_WORKER : 1;
+	long chunk = (n + most - 1) / most;
+	if(chunk < grain)
+		chunk = grain;
+	long nchunks = p ? (n + chunk - 1) / chunk : 1;
+	size_t stride = (size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+	char *slots = nchunks > 1 ? aligned_alloc(CACHE_LINE, nchunks * stride) : NULL;
+	if(slots == NULL){
+		if(end > begin)
+			body(begin, end, result, ctx);
+		return;
+	}
+
+	reduce_job job = { begin, end, chunk, body, ctx, result, size, slots, stride };
+	parallel_for(0, nchunks, 1, reduce_chunks, &job);
+	for (long c = 0; c < nchunks; c++)
+		combine(result, slots + c * stride, ctx);
+	free(slots);
+}
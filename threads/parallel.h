@@ -0,0 +1,49 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+/* loops over a range of indices, spread over the workers of a pool.
+
+	static void scale(long begin, long end, void *ctx){
+		double *a = ctx;
+		for (long i = begin; i < end; i++)
+			a[i] *= 2;
+	}
+	parallel_for(0, n, 4096, scale, a);
+
+   parallel_for cuts [begin, end) in halves, about four pieces per
+   worker to start with. A piece that gets stolen was wanted by an
+   idle worker, so it is cut further, down to grain indices; a piece
+   that stays with the worker that cut it runs as one loop. fn gets
+   the pieces, in any order and on any worker, and parallel_for
+   returns once all of them are done.
+
+   parallel_reduce cuts the range into fixed chunks instead (at least
+   grain long, at most 16 per worker) so that the answer doesn't
+   depend on who ran what: *result holds the identity when called,
+   every chunk starts from a copy of it and body adds its indices
+   into that, then the chunks are combined left to right into
+   *result. combine only has to be associative, and a floating point
+   sum comes out the same every time on the same number of workers.
+   Each chunk's partial result has its own cache lines, so workers
+   don't write into each other's.
+
+   Both run on a pool with a worker per CPU that is made on first use,
+   or on the one given to parallel_use_pool. Called from inside a task
+   of that pool, the caller's worker joins in; ranges of at most grain
+   run on the calling thread without the pool.
+
+   gcc -pthread ... parallel.c pool.c */
+#include <stddef.h>
+#include "pool.h"
+
+typedef void (*parallel_body)(long begin, long end, void *ctx);
+typedef void (*parallel_reduce_body)(long begin, long end, void *acc, void *ctx);
+typedef void (*parallel_combine)(void *acc, const void *other, void *ctx);
+
+void parallel_for(long begin, long end, long grain, parallel_body fn, void *ctx);
+void parallel_reduce(long begin, long end, long grain, void *result, size_t size,
+		     parallel_reduce_body body, parallel_combine combine, void *ctx);
+
+/* NULL goes back to the default pool. Not while a loop is running */
+void parallel_use_pool(pool *p);
+
+#endif
@@ -0,0 +1,153 @@
+/* parallel_for and parallel_reduce on an array of ints: the gdb/sum.c
+   and sum/max_of loops, and a histogram, at array sizes where it pays.
+
+	./parallel_bench [elements in millions] [workers]
+
+   The array is filled once to fault its pages in, then the timed
+   runs: a fill with parallel_for, sum, max and a 256 bin
+   histogram of the top byte, serially and with parallel_reduce on
+   pools of 1, 2, 4 ... workers up to one per CPU (or [workers]);
+   the answers are checked against the serial ones. The histogram
+   has 2 KiB of partial result per chunk, where false sharing would
+   hurt most.
+
+   gcc -O2 -pthread parallel_bench.c parallel.c pool.c -o parallel_bench */
+#define _GNU_SOURCE
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "parallel.h"
+
+#define GRAIN 16384
+#define BINS 256
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill(long begin, long end, void *ctx){
+	int *a = ctx;
+	for (long i = begin; i < end; i++)
+		a[i] = (int)((unsigned long)i * 2654435761u);
+}
+
+static void sum_body(long begin, long end, void *acc, void *ctx){
+	const int *a = ctx;
+	long long s = 0;
+	for (long i = begin; i < end; i++)
+		s += a[i];
+	*(long long *)acc += s;
+}
+
+static void sum_combine(void *acc, const void *other, void *ctx){
+	(void)ctx;
+	*(long long *)acc += *(const long long *)other;
+}
+
+static void max_body(long begin, long end, void *acc, void *ctx){
+	const int *a = ctx;
+	int m = *(int *)acc;
+	for (long i = begin; i < end; i++)
+		if(a[i] > m)
+			m = a[i];
+	*(int *)acc = m;
+}
+
+static void max_combine(void *acc, const void *other, void *ctx){
+	(void)ctx;
+	if(*(const int *)other > *(int *)acc)
+		*(int *)acc = *(const int *)other;
+}
+
+static void hist_body(long begin, long end, void *acc, void *ctx){
+	const int *a = ctx;
+	long *bins = acc;
+	for (long i = begin; i < end; i++)
+		bins[(unsigned)a[i] >> 24]++;
+}
+
+static void hist_combine(void *acc, const void *other, void *ctx){
+	(void)ctx;
+	long *bins = acc;
+	const long *more = other;
+	for (int b = 0; b < BINS; b++)
+		bins[b] += more[b];
+}
+
+int main(int argc, char *argv[]){
+	long n = (argc > 1 ? atol(argv[1]) : 64) * 1000000;
+	cpu_set_t allowed;
+	sched_getaffinity(0, sizeof allowed, &allowed);
+	int ncpus = CPU_COUNT(&allowed);
+	int most = argc > 2 ? atoi(argv[2]) : ncpus;
+	int *a = malloc(n * sizeof *a);
+	if(a == NULL){
+		perror("malloc");
+		return 1;
+	}
+	printf("%ld ints, %d CPUs\n\n", n, ncpus);
+
+	fill(0, n, a);
+	double t0 = now();
+	fill(0, n, a);
+	double fill_1 = now() - t0;
+	long long want_sum = 0;
+	t0 = now();
+	sum_body(0, n, &want_sum, a);
+	double sum_1 = now() - t0;
+	int want_max = INT_MIN;
+	t0 = now();
+	max_body(0, n, &want_max, a);
+	double max_1 = now() - t0;
+	static long want_hist[BINS];
+	t0 = now();
+	hist_body(0, n, want_hist, a);
+	double hist_1 = now() - t0;
+
+	printf("%-8s %10s %10s %10s %10s   (ms)\n", "workers", "fill", "sum", "max", "histogram");
+	printf("%-8s %10.1f %10.1f %10.1f %10.1f\n", "serial", fill_1 * 1e3, sum_1 * 1e3, max_1 * 1e3, hist_1 * 1e3);
+
+	int failed = 0;
+	for (int w = 1; ; w = w * 2 < most ? w * 2 : most){
+		pool *p = pool_create(w, 1);
+		if(p == NULL){
+			perror("pool_create");
+			return 1;
+		}
+		parallel_use_pool(p);
+
+		t0 = now();
+		parallel_for(0, n, GRAIN, fill, a);
+		double fill_t = now() - t0;
+		long long sum = 0;
+		t0 = now();
+		parallel_reduce(0, n, GRAIN, &sum, sizeof sum, sum_body, sum_combine, a);
+		double sum_t = now() - t0;
+		int max = INT_MIN;
+		t0 = now();
+		parallel_reduce(0, n, GRAIN, &max, sizeof max, max_body, max_combine, a);
+		double max_t = now() - t0;
+		long hist[BINS] = { 0 };
+		t0 = now();
+		parallel_reduce(0, n, GRAIN, hist, sizeof hist, hist_body, hist_combine, a);
+		double hist_t = now() - t0;
+
+		parallel_use_pool(NULL);
+		pool_destroy(p);
+		printf("%-8d %10.1f %10.1f %10.1f %10.1f\n", w, fill_t * 1e3, sum_t * 1e3, max_t * 1e3, hist_t * 1e3);
+		if(sum != want_sum || max != want_max || memcmp(hist, want_hist, sizeof hist) != 0){
+			printf("WRONG: sum %lld (want %lld), max %d (want %d)%s\n", sum, want_sum, max, want_max,
+			       memcmp(hist, want_hist, sizeof hist) ? ", histogram differs" : "");
+			failed = 1;
+		}
+		if(w >= most)
+			break;
+	}
+	free(a);
+	return failed;
+}
@@ -0,0 +1,319 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "pool.h"
+
+#define CACHE_LINE 64
+#define DEQUE_SIZE 8192         /* a full deque runs the task on the spot */
+#define SPINS 64                /* rounds of looking for work before sleeping */
+
+/* Chase-Lev, in the C11 version of Le, Pop, Cohen and Zappa Nardelli,
+   "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP
+   2013), with a fixed size array. top and bottom only grow. */
+typedef struct{
+	_Alignas(CACHE_LINE) atomic_long top;
+	_Alignas(CACHE_LINE) atomic_long bottom;
+	_Alignas(CACHE_LINE) pool_task *_Atomic tasks[DEQUE_SIZE];
+}deque;
+
+typedef struct{
+	deque q;
+	pool *p;
+	int index;
+	uint64_t rand;
+	pthread_t thread;
+}worker;
+
+struct pool{
+	int n;
+	worker *workers;
+
+	pthread_mutex_t inject_lock;
+	pool_task *inject_head, *inject_tail;
+	atomic_int injected;
+
+	_Alignas(CACHE_LINE) atomic_int epoch;  /* futex, bumped when there is new work */
+	atomic_int sleepers;
+	atomic_int stop;
+};
+
+static _Thread_local worker *self;
+
+static void futex_wait(atomic_int *addr, int val){
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+static void futex_wake(atomic_int *addr, int n){
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+/* owner only */
+static int push(deque *q, pool_task *t){
+	long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+	long top = atomic_load_explicit(&q->top, memory_order_acquire);
+	if(b - top >= DEQUE_SIZE)
+		return -1;
+	atomic_store_explicit(&q->tasks[b % DEQUE_SIZE], t, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+	return 0;
+}
+
+/* owner only */
+static pool_task *pop(deque *q){
+	long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	long top = atomic_load_explicit(&q->top, memory_order_relaxed);
+	pool_task *t = NULL;
+	if(top <= b){
+		t = atomic_load_explicit(&q->tasks[b % DEQUE_SIZE], memory_order_relaxed);
+		if(top == b){
+			/* the last one, a thief may be after it too */
+			if(!atomic_compare_exchange_strong_explicit(&q->top, &top, top + 1,
+								     memory_order_seq_cst, memory_order_relaxed))
+				t = NULL;
+			atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+		}
+	}else
+		atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+	return t;
+}
+
+/* anyone; NULL when empty or when another thief was quicker */
+static pool_task *steal(deque *q){
+	long top = atomic_load_explicit(&q->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+	if(top >= b)
+		return NULL;
+	pool_task *t = atomic_load_explicit(&q->tasks[top % DEQUE_SIZE], memory_order_relaxed);
+	if(!atomic_compare_exchange_strong_explicit(&q->top, &top, top + 1,
+						     memory_order_seq_cst, memory_order_relaxed))
+		return NULL;
+	return t;
+}
+
+static int deque_empty(deque *q){
+	return atomic_load_explicit(&q->top, memory_order_relaxed) >=
+	       atomic_load_explicit(&q->bottom, memory_order_relaxed);
+}
+
+static pool_task *take_injected(pool *p){
+	if(atomic_load_explicit(&p->injected, memory_order_relaxed) == 0)
+		return NULL;
+	pthread_mutex_lock(&p->inject_lock);
+	pool_task *t = p->inject_head;
+	if(t){
+		p->inject_head = t->next;
+		if(p->inject_head == NULL)
+			p->inject_tail = NULL;
+		atomic_fetch_sub_explicit(&p->injected, 1, memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&p->inject_lock);
+	return t;
+}
+
+static pool_task *find_work(worker *w){
+	pool *p = w->p;
+	pool_task *t = pop(&w->q);
+	if(t == NULL)
+		t = take_injected(p);
+	if(t == NULL && p->n > 1){
+		/* every other worker once, from a random one on */
+		w->rand ^= w->rand << 13;
+		w->rand ^= w->rand >> 7;
+		w->rand ^= w->rand << 17;
+		int start = w->rand % p->n;
+		for (int i = 0; i < p->n && t == NULL; i++){
+			int v = (start + i) % p->n;
+			if(v != w->index)
+				t = steal(&p->workers[v].q);
+		}
+	}
+	return t;
+}
+
+static int has_work(pool *p){
+	if(atomic_load_explicit(&p->injected, memory_order_relaxed))
+		return 1;
+	for (int i = 0; i < p->n; i++)
+		if(!deque_empty(&p->workers[i].q))
+			return 1;
+	return 0;
+}
+
+/* after new work is visible: wake one sleeper, if there is any. The
+   seq_cst fence pairs with the one in park, so either the sleeper
+   sees the work or we see the sleeper */
+static void notify(pool *p){
+	atomic_thread_fence(memory_order_seq_cst);
+	if(atomic_load_explicit(&p->sleepers, memory_order_relaxed) > 0){
+		atomic_fetch_add(&p->epoch, 1);
+		futex_wake(&p->epoch, 1);
+	}
+}
+
+static void park(pool *p){
+	int epoch = atomic_load(&p->epoch);
+	atomic_fetch_add_explicit(&p->sleepers, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	if(!has_work(p) && !atomic_load(&p->stop))
+		futex_wait(&p->epoch, epoch);
+	atomic_fetch_sub_explicit(&p->sleepers, 1, memory_order_relaxed);
+}
+
+static void run(pool_task *t){
+	t->result = t->fn(t->arg);
+	if(atomic_exchange_explicit(&t->done, 1, memory_order_acq_rel) == 2)
+		futex_wake(&t->done, INT_MAX);
+}
+
+static void *worker_main(void *arg){
+	worker *w = arg;
+	pool *p = w->p;
+	self = w;
+	int idle = 0;
+	while(!atomic_load_explicit(&p->stop, memory_order_relaxed)){
+		pool_task *t = find_work(w);
+		if(t){
+			run(t);
+			idle = 0;
+		}else if(++idle < SPINS)
+			sched_yield();
+		else{
+			park(p);
+			idle = 0;
+		}
+	}
+	return NULL;
+}
+
+pool *pool_create(int nthreads, int pin){
+	cpu_set_t allowed;
+	int cpus[CPU_SETSIZE], ncpus = 0;
+	if(sched_getaffinity(0, sizeof allowed, &allowed) == -1)
+		return NULL;
+	for (int c = 0; c < CPU_SETSIZE; c++)
+		if(CPU_ISSET(c, &allowed))
+			cpus[ncpus++] = c;
+	if(nthreads <= 0)
+		nthreads = ncpus;
+
+	pool *p = calloc(1, sizeof *p);
+	worker *workers = p ? aligned_alloc(CACHE_LINE, nthreads * sizeof *workers) : NULL;
+	if(workers == NULL){
+		free(p);
+		errno = ENOMEM;
+		return NULL;
+	}
+	p->n = nthreads;
+	p->workers = workers;
+	pthread_mutex_init(&p->inject_lock, NULL);
+	for (int i = 0; i < nthreads; i++){
+		worker *w = &workers[i];
+		atomic_init(&w->q.top, 0);
+		atomic_init(&w->q.bottom, 0);
+		w->p = p;
+		w->index = i;
+		w->rand = 0x9e3779b97f4a7c15ULL * (i + 1);
+	}
+	int started = 0, err = 0;
+	while(started < nthreads && err == 0){
+		worker *w = &workers[started];
+		if((err = pthread_create(&w->thread, NULL, worker_main, w)) != 0)
+			break;
+		started++;
+		if(pin){
+			cpu_set_t one;
+			CPU_ZERO(&one);
+			CPU_SET(cpus[(started - 1) % ncpus], &one);
+			err = pthread_setaffinity_np(w->thread, sizeof one, &one);
+		}
+	}
+	if(err){
+		atomic_store(&p->stop, 1);
+		atomic_fetch_add(&p->epoch, 1);
+		futex_wake(&p->epoch, INT_MAX);
+		for (int i = 0; i < started; i++)
+			pthread_join(workers[i].thread, NULL);
+		pthread_mutex_destroy(&p->inject_lock);
+		free(workers);
+		free(p);
+		errno = err;
+		return NULL;
+	}
+	return p;
+}
+
+void pool_destroy(pool *p){
+	atomic_store(&p->stop, 1);
+	atomic_fetch_add(&p->epoch, 1);
+	futex_wake(&p->epoch, INT_MAX);
+	for (int i = 0; i < p->n; i++)
+		pthread_join(p->workers[i].thread, NULL);
+	pthread_mutex_destroy(&p->inject_lock);
+	free(p->workers);
+	free(p);
+}
+
+int pool_size(const pool *p){
+	return p->n;
+}
+
+int pool_worker_index(const pool *p){
+	return self && self->p == p ? self->index : -1;
+}
+
+void pool_spawn(pool *p, pool_task *t, void *(*fn)(void *), void *arg){
+	t->fn = fn;
+	t->arg = arg;
+	t->next = NULL;
+	atomic_store_explicit(&t->done, 0, memory_order_relaxed);
+	if(self && self->p == p){
+		if(push(&self->q, t) == -1){
+			run(t);
+			return;
+		}
+	}else{
+		pthread_mutex_lock(&p->inject_lock);
+		if(p->inject_tail)
+			p->inject_tail->next = t;
+		else
+			p->inject_head = t;
+		p->inject_tail = t;
+		atomic_fetch_add_explicit(&p->injected, 1, memory_order_relaxed);
+		pthread_mutex_unlock(&p->inject_lock);
+	}
+	notify(p);
+}
+
+void *pool_join(pool *p, pool_task *t){
+	if(self && self->p == p){
+		/* help out until it is done: whatever is left of it is either
+		   on top of our own deque or already running somewhere */
+		while(atomic_load_explicit(&t->done, memory_order_acquire) == 0){
+			pool_task *other = find_work(self);
+			if(other)
+				run(other);
+			else
+				sched_yield();
+		}
+	}else{
+		int done;
+		while((done = atomic_load_explicit(&t->done, memory_order_acquire)) != 1){
+			int zero = 0;
+			if(done == 0 && !atomic_compare_exchange_strong(&t->done, &zero, 2))
+				continue;
+			futex_wait(&t->done, 2);
+		}
+	}
+	return t->result;
+}
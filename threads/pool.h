@@ -0,0 +1,53 @@
+#ifndef POOL_H
+#define POOL_H
+/* a fixed set of worker threads that tasks are handed to, instead of a
+   pthread_create per task like thread_creation.c.
+
+	pool *p = pool_create(0, 1);
+	pool_task t;
+	pool_spawn(p, &t, work, arg);
+	...
+	void *result = pool_join(p, &t);
+	pool_destroy(p);
+
+   Every worker has its own deque (Chase-Lev): it pushes and pops its
+   own tasks at the bottom, without locks, and idle workers steal from
+   the top of the others'. Tasks spawned from outside the pool go to a
+   shared injection queue. A worker that finds nothing anywhere sleeps
+   on a futex until something is spawned.
+
+   A task spawned from inside a task lands in the worker's own deque,
+   so fork/join recursion stays on one core until somebody is idle
+   enough to steal. pool_join from inside a task doesn't block the
+   worker: it runs other tasks until the one it waits for is done.
+
+   The pool_task is the caller's (often on the stack) and must stay
+   put until pool_join has returned; every spawned task is joined
+   exactly once. Destroy the pool only when all of them are joined.
+
+   gcc -pthread ... pool.c */
+#include <stdatomic.h>
+
+typedef struct pool pool;
+
+typedef struct pool_task{
+	void *(*fn)(void *);
+	void *arg;
+	void *result;
+	atomic_int done;                /* 0 queued/running, 1 done, 2 someone sleeps on it */
+	struct pool_task *next;         /* in the injection queue */
+}pool_task;
+
+/* nthreads <= 0: one per CPU we may run on. pin: worker i is bound to
+   the i-th of those CPUs. NULL with errno set on failure */
+pool *pool_create(int nthreads, int pin);
+void pool_destroy(pool *p);
+int pool_size(const pool *p);
+
+void pool_spawn(pool *p, pool_task *t, void *(*fn)(void *), void *arg);
+void *pool_join(pool *p, pool_task *t);
+
+/* index of the calling worker of p, or -1 outside it */
+int pool_worker_index(const pool *p);
+
+#endif
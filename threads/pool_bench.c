@@ -0,0 +1,178 @@
+/* pool.c against a thread per task, and how fork/join work scales.
+
+	./pool_bench [fib n] [sum elements in millions] [workers]
+
+   1. spawn + join of an empty task: pthread_create/pthread_join
+      against pool_spawn/pool_join from outside the pool and from
+      inside a task.
+   2. fib(n) the naive recursive way, every call above n = 2 spawns
+      fib(n - 1) and works out fib(n - 2) itself, so almost all of it
+      is task overhead. Once serially, then on pools of 1, 2, 4 ...
+      workers up to one per CPU (or [workers]). The speedup is against
+      the pool of 1, the serial time is what the overhead costs.
+   3. the sum of an array of ints, split in halves down to 64K
+      elements, same pool sizes. This one is bound by memory
+      bandwidth long before it runs out of cores.
+
+   gcc -O2 -pthread pool_bench.c pool.c -o pool_bench */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pool.h"
+
+#define SPAWNS 20000
+#define SUM_LEAF 65536
+
+static pool *P;
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *nothing(void *arg){
+	return arg;
+}
+
+static void *spawn_inside(void *arg){
+	long n = (long)arg;
+	pool_task t;
+	for (long i = 0; i < n; i++){
+		pool_spawn(P, &t, nothing, NULL);
+		pool_join(P, &t);
+	}
+	return NULL;
+}
+
+static long fib_serial(long n){
+	return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+static void *fib(void *arg){
+	long n = (long)arg;
+	if(n <= 2)
+		return (void *)fib_serial(n);
+	pool_task t;
+	pool_spawn(P, &t, fib, (void *)(n - 1));
+	long b = (long)fib((void *)(n - 2));
+	return (void *)((long)pool_join(P, &t) + b);
+}
+
+typedef struct{
+	const int *a;
+	long n;
+	long long sum;
+}range;
+
+static long long sum_serial(const int *a, long n){
+	long long s = 0;
+	for (long i = 0; i < n; i++)
+		s += a[i];
+	return s;
+}
+
+static void *sum(void *arg){
+	range *r = arg;
+	if(r->n <= SUM_LEAF){
+		r->sum = sum_serial(r->a, r->n);
+		return NULL;
+	}
+	range left = { r->a, r->n / 2, 0 }, right = { r->a + r->n / 2, r->n - r->n / 2, 0 };
+	pool_task t;
+	pool_spawn(P, &t, sum, &left);
+	sum(&right);
+	pool_join(P, &t);
+	r->sum = left.sum + right.sum;
+	return NULL;
+}
+
+/* from outside the pool, as a program would */
+static void *run_in_pool(void *(*fn)(void *), void *arg){
+	pool_task t;
+	pool_spawn(P, &t, fn, arg);
+	return pool_join(P, &t);
+}
+
+int main(int argc, char *argv[]){
+	long fib_n = argc > 1 ? atol(argv[1]) : 30;
+	long sum_n = (argc > 2 ? atol(argv[2]) : 64) * 1000000;
+	cpu_set_t allowed;
+	sched_getaffinity(0, sizeof allowed, &allowed);
+	int ncpus = CPU_COUNT(&allowed);
+	int most = argc > 3 ? atoi(argv[3]) : ncpus;
+	printf("%d CPUs\n\n", ncpus);
+
+	double t0 = now();
+	for (int i = 0; i < SPAWNS; i++){
+		pthread_t th;
+		pthread_create(&th, NULL, nothing, NULL);
+		pthread_join(th, NULL);
+	}
+	printf("%-36s %8.2f us\n", "pthread_create + join", (now() - t0) / SPAWNS * 1e6);
+	P = pool_create(0, 1);
+	if(P == NULL){
+		perror("pool_create");
+		return 1;
+	}
+	t0 = now();
+	for (int i = 0; i < SPAWNS; i++)
+		run_in_pool(nothing, NULL);
+	printf("%-36s %8.2f us\n", "pool_spawn + join, from outside", (now() - t0) / SPAWNS * 1e6);
+	t0 = now();
+	run_in_pool(spawn_inside, (void *)(SPAWNS * 10L));
+	printf("%-36s %8.2f us\n\n", "pool_spawn + join, inside a task", (now() - t0) / (SPAWNS * 10) * 1e6);
+	pool_destroy(P);
+
+	int *a = malloc(sum_n * sizeof *a);
+	if(a == NULL){
+		perror("malloc");
+		return 1;
+	}
+	for (long i = 0; i < sum_n; i++)
+		a[i] = (int)(i * 2654435761u) >> 8;
+
+	t0 = now();
+	long want_fib = fib_serial(fib_n);
+	double fib_1 = now() - t0;
+	t0 = now();
+	long long want_sum = sum_serial(a, sum_n);
+	double sum_1 = now() - t0;
+	printf("%-8s %14s %8s %14s %8s\n", "workers", "fib ms", "speedup", "sum ms", "speedup");
+	printf("%-8s %14.1f %8s %14.1f %8s\n", "serial", fib_1 * 1e3, "", sum_1 * 1e3, "");
+
+	int failed = 0;
+	double fib_base = 0, sum_base = 0;
+	for (int n = 1; ; n = n * 2 < most ? n * 2 : most){
+		P = pool_create(n, 1);
+		if(P == NULL){
+			perror("pool_create");
+			return 1;
+		}
+		t0 = now();
+		long got_fib = (long)run_in_pool(fib, (void *)fib_n);
+		double fib_t = now() - t0;
+		range r = { a, sum_n, 0 };
+		t0 = now();
+		run_in_pool(sum, &r);
+		double sum_t = now() - t0;
+		pool_destroy(P);
+		if(n == 1){
+			fib_base = fib_t;
+			sum_base = sum_t;
+		}
+		printf("%-8d %14.1f %8.2f %14.1f %8.2f\n", n, fib_t * 1e3, fib_base / fib_t, sum_t * 1e3, sum_base / sum_t);
+		if(got_fib != want_fib || r.sum != want_sum){
+			printf("WRONG: fib %ld (want %ld), sum %lld (want %lld)\n", got_fib, want_fib, r.sum, want_sum);
+			failed = 1;
+		}
+		if(n >= most)
+			break;
+	}
+	free(a);
+	return failed;
+}
@@ -0,0 +1,117 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stats.h"
+
+_Thread_local int stat_my_slot;
+
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char taken[STAT_SHARDS];
+static pthread_key_t slot_key;
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+
+/* at thread exit; what the thread counted stays in the slot */
+static void give_back(void *arg){
+	int s = (int)(intptr_t)arg - 1;
+	pthread_mutex_lock(&slots_lock);
+	taken[s] = 0;
+	pthread_mutex_unlock(&slots_lock);
+	stat_my_slot = 0;
+}
+
+static void make_key(void){
+	pthread_key_create(&slot_key, give_back);
+}
+
+int stat_take_slot(void){
+	pthread_once(&key_once, make_key);
+	int s = 0;
+	pthread_mutex_lock(&slots_lock);
+	while(s < STAT_SHARDS && taken[s])
+		s++;
+	if(s < STAT_SHARDS)
+		taken[s] = 1;
+	pthread_mutex_unlock(&slots_lock);
+	if(s < STAT_SHARDS)
+		pthread_setspecific(slot_key, (void *)(intptr_t)(s + 1));
+	stat_my_slot = s + 1;
+	return s;
+}
+
+stat_hist_shard *stat_hist_new_shard(stat_hist *h, int slot){
+	stat_hist_shard *sh = aligned_alloc(64, (sizeof *sh + 63) & ~(size_t)63), *none = NULL;
+	if(sh == NULL)
+		return NULL;
+	memset(sh, 0, sizeof *sh);
+	/* only the shared slot can be raced for */
+	if(!atomic_compare_exchange_strong_explicit(&h->shard[slot], &none, sh,
+						     memory_order_acq_rel, memory_order_acquire)){
+		free(sh);
+		return none;
+	}
+	return sh;
+}
+
+long long stat_read(const stat_counter *c){
+	long long total = 0;
+	for (int s = 0; s <= STAT_SHARDS; s++)
+		total += atomic_load_explicit(&c->shard[s].v, memory_order_relaxed);
+	return total;
+}
+
+void stat_hist_read(const stat_hist *h, stat_hist_totals *out){
+	uint64_t sum = 0, not_min = 0, max = 0;
+	memset(out, 0, sizeof *out);
+	for (int s = 0; s <= STAT_SHARDS; s++){
+		stat_hist_shard *sh = atomic_load_explicit(&h->shard[s], memory_order_acquire);
+		if(sh == NULL)
+			continue;
+		for (int b = 0; b < STAT_HIST_BUCKETS; b++){
+			long long n = atomic_load_explicit(&sh->count[b], memory_order_relaxed);
+			out->buckets[b] += n;
+			out->count += n;
+		}
+		sum += atomic_load_explicit(&sh->sum, memory_order_relaxed);
+		uint64_t m = atomic_load_explicit(&sh->min, memory_order_relaxed);
+		if(m > not_min)
+			not_min = m;
+		m = atomic_load_explicit(&sh->max, memory_order_relaxed);
+		if(m > max)
+			max = m;
+	}
+	out->min = out->count ? ~not_min : 0;
+	out->max = max;
+	out->mean = out->count ? (double)sum / out->count : 0;
+}
+
+uint64_t stat_hist_bucket_top(int b){
+	if(b < (1 << STAT_HIST_BITS))
+		return b;
+	int shift = (b >> STAT_HIST_BITS) - 1;
+	uint64_t low = (uint64_t)((b & ((1 << STAT_HIST_BITS) - 1)) + (1 << STAT_HIST_BITS)) << shift;
+	return low + ((1ULL << shift) - 1);
+}
+
+uint64_t stat_hist_percentile(const stat_hist_totals *t, double p){
+	if(t->count == 0)
+		return 0;
+	long long want = (long long)(p / 100 * t->count + 0.5);
+	if(want < 1)
+		want = 1;
+	long long seen = 0;
+	for (int b = 0; b < STAT_HIST_BUCKETS; b++){
+		seen += t->buckets[b];
+		if(seen >= want){
+			uint64_t top = stat_hist_bucket_top(b);
+			return top < t->max ? top : t->max;
+		}
+	}
+	return t->max;
+}
+
+void stat_hist_free(stat_hist *h){
+	for (int s = 0; s <= STAT_SHARDS; s++){
+		free(atomic_load(&h->shard[s]));
+		atomic_store(&h->shard[s], NULL);
+	}
+}
@@ -0,0 +1,139 @@
+#ifndef STATS_H
+#define STATS_H
+/* counters and latency histograms that many threads can bump at once,
+   in place of the static int sum that summer() in
+   program_management/static_class.c keeps (which, with threads, is a
+   data race, and as one atomic a cache line every core fights over).
+
+	static stat_counter requests;
+	static stat_hist latency;
+
+	stat_inc(&requests);
+	stat_hist_record(&latency, ns);
+	...
+	printf("%lld requests\n", stat_read(&requests));
+
+   Each of the first STAT_SHARDS threads to touch a counter gets a
+   slot of its own, and every counter has a cache line per slot, so a
+   thread adds with a plain (relaxed) load and store to a line nobody
+   else writes. A slot goes back when its thread exits, with its count
+   still in it, for the next thread to add to. Threads beyond
+   STAT_SHARDS share one more line with atomic adds. Reading adds up
+   all the lines: a count as it was at some point during the read,
+   not a snapshot across counters. There is no reset; take
+   differences of reads instead.
+
+   Histograms count values (say nanoseconds) in log-linear buckets
+   like HdrHistogram's: exact below 2^STAT_HIST_BITS, above that
+   2^STAT_HIST_BITS buckets for every power of two, so any value is
+   known to within 1/128 of itself, over the whole 64 bit range. A
+   thread's buckets (59 KiB) are allocated the first time it records.
+
+   Both are zero initialized (static, or memset) and ready to use.
+
+   gcc -pthread ... stats.c */
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define STAT_SHARDS 64
+#define STAT_HIST_BITS 7
+#define STAT_HIST_BUCKETS ((65 - STAT_HIST_BITS) << STAT_HIST_BITS)
+
+typedef struct{
+	_Alignas(64) atomic_llong v;
+}stat_shard;
+
+typedef struct{
+	stat_shard shard[STAT_SHARDS + 1];      /* the last one is shared */
+}stat_counter;
+
+typedef struct{
+	atomic_llong count[STAT_HIST_BUCKETS];
+	atomic_ullong min, max;         /* min is stored as ~min, so 0 means none */
+	atomic_ullong sum;
+}stat_hist_shard;
+
+typedef struct{
+	stat_hist_shard *_Atomic shard[STAT_SHARDS + 1];
+}stat_hist;
+
+/* what stat_hist_read adds up */
+typedef struct{
+	long long count;
+	uint64_t min, max;
+	double mean;
+	long long buckets[STAT_HIST_BUCKETS];
+}stat_hist_totals;
+
+extern _Thread_local int stat_my_slot;  /* slot + 1, 0 before the first use */
+int stat_take_slot(void);
+stat_hist_shard *stat_hist_new_shard(stat_hist *h, int slot);
+
+static inline int stat_slot(void){
+	int s = stat_my_slot;
+	return s ? s - 1 : stat_take_slot();
+}
+
+/* relaxed add to a line only this thread writes */
+static inline void stat_bump(atomic_llong *v, long long n){
+	atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static inline void stat_add(stat_counter *c, long long n){
+	int s = stat_slot();
+	if(s < STAT_SHARDS)
+		stat_bump(&c->shard[s].v, n);
+	else
+		atomic_fetch_add_explicit(&c->shard[s].v, n, memory_order_relaxed);
+}
+
+static inline void stat_inc(stat_counter *c){
+	stat_add(c, 1);
+}
+
+long long stat_read(const stat_counter *c);
+
+static inline int stat_hist_bucket(uint64_t v){
+	if(v < (1u << STAT_HIST_BITS))
+		return v;
+	int shift = 63 - __builtin_clzll(v) - STAT_HIST_BITS;
+	return (shift << STAT_HIST_BITS) + (int)(v >> shift);
+}
+
+static inline void stat_hist_record(stat_hist *h, uint64_t v){
+	int s = stat_slot();
+	stat_hist_shard *sh = atomic_load_explicit(&h->shard[s], memory_order_acquire);
+	if(sh == NULL && (sh = stat_hist_new_shard(h, s)) == NULL)
+		return;
+	int b = stat_hist_bucket(v);
+	if(s < STAT_SHARDS){
+		stat_bump(&sh->count[b], 1);
+		atomic_store_explicit(&sh->sum, atomic_load_explicit(&sh->sum, memory_order_relaxed) + v,
+				      memory_order_relaxed);
+		if(~v > atomic_load_explicit(&sh->min, memory_order_relaxed))
+			atomic_store_explicit(&sh->min, ~v, memory_order_relaxed);
+		if(v > atomic_load_explicit(&sh->max, memory_order_relaxed))
+			atomic_store_explicit(&sh->max, v, memory_order_relaxed);
+	}else{
+		atomic_fetch_add_explicit(&sh->count[b], 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&sh->sum, v, memory_order_relaxed);
+		uint64_t m = atomic_load_explicit(&sh->min, memory_order_relaxed);
+		while(~v > m && !atomic_compare_exchange_weak_explicit(&sh->min, &m, ~v,
+									memory_order_relaxed, memory_order_relaxed))
+			;
+		m = atomic_load_explicit(&sh->max, memory_order_relaxed);
+		while(v > m && !atomic_compare_exchange_weak_explicit(&sh->max, &m, v,
+								       memory_order_relaxed, memory_order_relaxed))
+			;
+	}
+}
+
+void stat_hist_read(const stat_hist *h, stat_hist_totals *out);
+/* the value at or below which p percent of the values are, as the top
+   of its bucket, so never less than the real one */
+uint64_t stat_hist_percentile(const stat_hist_totals *t, double p);
+/* the largest value that lands in bucket b */
+uint64_t stat_hist_bucket_top(int b);
+void stat_hist_free(stat_hist *h);
+
+#endif
@@ -0,0 +1,173 @@
+/* stat_counter against the ways a shared count usually gets kept:
+   one atomic_long everybody adds to, and a long behind a mutex (what
+   summer()'s static int sum turns into once it is made thread safe).
+   Then stat_hist_record against a histogram behind a mutex, and how
+   close stat_hist_percentile gets to the exact percentiles.
+
+	./stats_bench [adds per thread] [most threads]
+
+   ns/add is wall time over all adds of all threads, for 1, 2, 4 ...
+   threads up to [most threads] (default 128, so past STAT_SHARDS and
+   into the shared slot). Every total is checked.
+
+   gcc -O2 -pthread stats_bench.c stats.c -o stats_bench */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+enum { ATOMIC, MUTEX, SHARDED, HIST_MUTEX, HIST_SHARDED, KINDS };
+
+static const char *names[] = { "one atomic", "mutex", "stat_counter", "histogram + mutex", "stat_hist" };
+
+static long adds;
+static atomic_long one_atomic;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static long locked_count;
+static stat_counter sharded;
+static long long locked_hist[STAT_HIST_BUCKETS];
+static stat_hist hist;
+static pthread_barrier_t start;
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* a cheap stand-in for a latency in ns: mostly small, a long tail */
+static uint64_t fake_latency(uint64_t *state){
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return 100 + (*state >> (40 + (*state & 15)));
+}
+
+static void *adder(void *arg){
+	int kind = (int)(intptr_t)arg;
+	uint64_t state = 88172645463325252ULL ^ (uintptr_t)&state;
+	pthread_barrier_wait(&start);
+	for (long i = 0; i < adds; i++){
+		switch(kind){
+			case ATOMIC:
+				atomic_fetch_add_explicit(&one_atomic, 1, memory_order_relaxed);
+				break;
+			case MUTEX:
+				pthread_mutex_lock(&lock);
+				locked_count++;
+				pthread_mutex_unlock(&lock);
+				break;
+			case SHARDED:
+				stat_inc(&sharded);
+				break;
+			case HIST_MUTEX:{
+				int b = stat_hist_bucket(fake_latency(&state));
+				pthread_mutex_lock(&lock);
+				locked_hist[b]++;
+				pthread_mutex_unlock(&lock);
+				break;
+			}
+			case HIST_SHARDED:
+				stat_hist_record(&hist, fake_latency(&state));
+				break;
+		}
+	}
+	return NULL;
+}
+
+static long long total(int kind){
+	long long n = 0;
+	stat_hist_totals *t;
+	switch(kind){
+		case ATOMIC:
+			return atomic_load(&one_atomic);
+		case MUTEX:
+			return locked_count;
+		case SHARDED:
+			return stat_read(&sharded);
+		case HIST_MUTEX:
+			for (int b = 0; b < STAT_HIST_BUCKETS; b++)
+				n += locked_hist[b];
+			return n;
+		default:
+			t = malloc(sizeof *t);
+			stat_hist_read(&hist, t);
+			n = t->count;
+			free(t);
+			return n;
+	}
+}
+
+static int by_value(const void *a, const void *b){
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]){
+	adds = argc > 1 ? atol(argv[1]) : 1000000;
+	int most = argc > 2 ? atoi(argv[2]) : 128;
+	pthread_t *threads = malloc(most * sizeof *threads);
+	int failed = 0;
+
+	printf("%-8s", "threads");
+	for (int k = 0; k < KINDS; k++)
+		printf(" %18s", names[k]);
+	printf("   (ns/add)\n");
+	for (int n = 1; ; n = n * 2 < most ? n * 2 : most){
+		printf("%-8d", n);
+		for (int k = 0; k < KINDS; k++){
+			long long before = total(k);
+			pthread_barrier_init(&start, NULL, n + 1);
+			for (int t = 0; t < n; t++)
+				pthread_create(&threads[t], NULL, adder, (void *)(intptr_t)k);
+			double t0 = now();
+			pthread_barrier_wait(&start);
+			for (int t = 0; t < n; t++)
+				pthread_join(threads[t], NULL);
+			double secs = now() - t0;
+			pthread_barrier_destroy(&start);
+			long long counted = total(k) - before;
+			printf(" %18.2f", secs / ((double)adds * n) * 1e9);
+			if(counted != adds * n){
+				printf(" WRONG: %lld", counted);
+				failed = 1;
+			}
+		}
+		putchar('\n');
+		if(n == most)
+			break;
+	}
+
+	/* the buckets against the exact percentiles of the same values */
+	long m = adds;
+	uint64_t *values = malloc(m * sizeof *values), state = 1;
+	stat_hist exact = { 0 };
+	for (long i = 0; i < m; i++){
+		values[i] = fake_latency(&state);
+		stat_hist_record(&exact, values[i]);
+	}
+	qsort(values, m, sizeof *values, by_value);
+	stat_hist_totals *t = malloc(sizeof *t);
+	stat_hist_read(&exact, t);
+	printf("\n%ld values: min %llu, max %llu, mean %.1f\n", m, (unsigned long long)t->min,
+	       (unsigned long long)t->max, t->mean);
+	static const double ps[] = { 50, 90, 99, 99.9, 99.99 };
+	for (int i = 0; i < 5; i++){
+		uint64_t want = values[(long)(ps[i] / 100 * m + 0.5) - 1];
+		uint64_t got = stat_hist_percentile(t, ps[i]);
+		double off = (double)got / want - 1;
+		printf("p%-6g exact %12llu   histogram %12llu   %+.3f%%\n", ps[i],
+		       (unsigned long long)want, (unsigned long long)got, off * 100);
+		if(off < 0 || off > 1.0 / (1 << STAT_HIST_BITS))
+			failed = 1;
+	}
+	free(t);
+	free(values);
+	stat_hist_free(&exact);
+	stat_hist_free(&hist);
+	free(threads);
+	return failed;
+}
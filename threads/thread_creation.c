@@ -1,13 +1,32 @@
+/* main and a thread made with pthread_create say hello every 2
+   seconds, 16 times each. Instead of each sleep(2)ing in its loop, they
+   wait on a semaphore that a periodic timer on the wheel (wheel.c)
+   posts, so both are paced by one timerfd. wheel_hello.c does the same
+   with no thread of its own, the callbacks print.
+
+   gcc -pthread thread_creation.c wheel.c */
 #include <pthread.h>
+#include <semaphore.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
+#include "wheel.h"
+
+#define SECONDS 1000000000ULL
+
+static wheel *w;
+
+static void tick(wheel_timer *t, void *arg){
+	(void)t;
+	sem_post(arg);
+}
 
 void *main2(void *arg){
+	sem_t *tock = arg;
 	int counter = 0;
 	while(1){
 		printf("hello from thread  two.\n");
-		sleep(2);
+		sem_wait(tock);
 		counter++;
 		if(counter > 15) return NULL;
 	}
@@ -16,16 +35,37 @@ void *main2(void *arg){
 
 int main(int argc, char **argv){
 	pthread_t t1;
-	pthread_create(&t1,NULL, main2, NULL);
+	wheel_timer timer1, timer2;
+	sem_t tock1, tock2;
+
+	sem_init(&tock1, 0, 0);
+	sem_init(&tock2, 0, 0);
+	w = wheel_create(0);
+	if(w == NULL){
+		perror("wheel_create");
+		return 1;
+	}
+	/* zeroed before their first wheel_start */
+	timer1 = timer2 = (wheel_timer){ 0 };
+	wheel_start(w, &timer1, 2 * SECONDS, 2 * SECONDS, tick, &tock1);
+	wheel_start(w, &timer2, 2 * SECONDS, 2 * SECONDS, tick, &tock2);
+
+	if((errno = pthread_create(&t1, NULL, main2, &tock2)) != 0){
+		perror("pthread_create");
+		return 1;
+	}
 
 	int counter = 0;
 	while(1){
 		printf("hello from thread  one.\n");
-		sleep(2);
+		sem_wait(&tock1);
 		counter++;
 		if(counter > 15) break;
 	}
 	pthread_join(t1, NULL);
 
+	wheel_cancel(w, &timer1);
+	wheel_cancel(w, &timer2);
+	wheel_destroy(w);
 	return 0;
 }
@@ -0,0 +1,218 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "topology.h"
+
+#define SYS_CPU "/sys/devices/system/cpu"
+#define SYS_NODE "/sys/devices/system/node"
+
+/* the one line of a small sysfs file, "" if there is none */
+static char *read_line(const char *path, char *buf, size_t size){
+	buf[0] = '\0';
+	FILE *fp = fopen(path, "r");
+	if(fp == NULL)
+		return buf;
+	if(fgets(buf, size, fp) == NULL)
+		buf[0] = '\0';
+	fclose(fp);
+	buf[strcspn(buf, "\n")] = '\0';
+	return buf;
+}
+
+static int read_int(const char *path, int fallback){
+	char buf[32];
+	return *read_line(path, buf, sizeof buf) ? atoi(buf) : fallback;
+}
+
+/* "0-3,8-11" -> set */
+static void parse_list(const char *s, cpu_set_t *set){
+	CPU_ZERO(set);
+	while(*s){
+		char *end;
+		long lo = strtol(s, &end, 10), hi = lo;
+		if(end == s)
+			break;
+		if(*end == '-')
+			hi = strtol(end + 1, &end, 10);
+		for (long c = lo; c <= hi && c < CPU_SETSIZE; c++)
+			CPU_SET(c, set);
+		s = *end == ',' ? end + 1 : end;
+	}
+}
+
+static int by_place(const void *a, const void *b){
+	const topo_cpu *x = a, *y = b;
+	if(x->node != y->node)
+		return x->node - y->node;
+	if(x->package != y->package)
+		return x->package - y->package;
+	if(x->core != y->core)
+		return x->core - y->core;
+	return x->cpu - y->cpu;
+}
+
+int topo_load(topology *t){
+	char path[128], line[4096];
+	cpu_set_t allowed, online;
+	memset(t, 0, sizeof *t);
+	if(sched_getaffinity(0, sizeof allowed, &allowed) == -1)
+		return -1;
+	parse_list(read_line(SYS_CPU "/online", line, sizeof line), &online);
+	if(CPU_COUNT(&online) == 0)
+		online = allowed;
+	CPU_AND(&allowed, &allowed, &online);
+
+	/* which node each CPU is on; no node directories is one node 0 */
+	int node_of[CPU_SETSIZE] = { 0 }, nodes[CPU_SETSIZE], nnodes = 0;
+	cpu_set_t node_set;
+	parse_list(read_line(SYS_NODE "/online", line, sizeof line), &node_set);
+	for (int n = 0; n < CPU_SETSIZE; n++){
+		if(!CPU_ISSET(n, &node_set))
+			continue;
+		cpu_set_t cpus;
+		snprintf(path, sizeof path, SYS_NODE "/node%d/cpulist", n);
+		parse_list(read_line(path, line, sizeof line), &cpus);
+		CPU_AND(&cpus, &cpus, &allowed);
+		if(CPU_COUNT(&cpus) == 0)
+			continue;       /* memory only, or none of ours */
+		nodes[nnodes++] = n;
+		for (int c = 0; c < CPU_SETSIZE; c++)
+			if(CPU_ISSET(c, &cpus))
+				node_of[c] = n;
+	}
+	if(nnodes == 0)
+		nodes[nnodes++] = 0;
+
+	int ncpus = CPU_COUNT(&allowed);
+	t->cpus = calloc(ncpus, sizeof *t->cpus);
+	t->compact = calloc(ncpus, sizeof *t->compact);
+	t->spread = calloc(ncpus, sizeof *t->spread);
+	t->nodes = calloc(nnodes, sizeof *t->nodes);
+	if(!t->cpus || !t->compact || !t->spread || !t->nodes){
+		topo_free(t);
+		errno = ENOMEM;
+		return -1;
+	}
+	memcpy(t->nodes, nodes, nnodes * sizeof *nodes);
+	t->nnodes = nnodes;
+	for (int c = 0; c < CPU_SETSIZE; c++){
+		if(!CPU_ISSET(c, &allowed))
+			continue;
+		topo_cpu *tc = &t->cpus[t->ncpus++];
+		tc->cpu = c;
+		tc->node = node_of[c];
+		snprintf(path, sizeof path, SYS_CPU "/cpu%d/topology/core_id", c);
+		tc->core = read_int(path, c);
+		snprintf(path, sizeof path, SYS_CPU "/cpu%d/topology/physical_package_id", c);
+		tc->package = read_int(path, 0);
+	}
+	qsort(t->cpus, t->ncpus, sizeof *t->cpus, by_place);
+
+	/* number the hyperthreads of each core, count cores and packages */
+	for (int i = 0; i < t->ncpus; i++){
+		topo_cpu *tc = &t->cpus[i];
+		if(i > 0 && tc[-1].package == tc->package && tc[-1].core == tc->core && tc[-1].node == tc->node)
+			tc->sibling = tc[-1].sibling + 1;
+		else
+			t->ncores++;
+		if(i == 0 || tc[-1].package != tc->package)
+			t->npackages++;
+		t->compact[i] = i;
+	}
+
+	/* spread: each node's CPUs as first threads of every core, then
+	   second threads ..., and those lists taken in turns */
+	int *by_node = malloc(t->ncpus * sizeof *by_node), *from = malloc((nnodes + 1) * sizeof *from);
+	if(!by_node || !from){
+		free(by_node);
+		free(from);
+		topo_free(t);
+		errno = ENOMEM;
+		return -1;
+	}
+	int pos = 0;
+	for (int n = 0; n < nnodes; n++){
+		from[n] = pos;
+		for (int sibling = 0, found = 1; found; sibling++){
+			found = 0;
+			for (int i = 0; i < t->ncpus; i++)
+				if(t->cpus[i].node == nodes[n] && t->cpus[i].sibling == sibling){
+					by_node[pos++] = i;
+					found = 1;
+				}
+		}
+	}
+	from[nnodes] = pos;
+	int filled = 0;
+	for (int round = 0; filled < t->ncpus; round++)
+		for (int n = 0; n < nnodes; n++)
+			if(from[n] + round < from[n + 1])
+				t->spread[filled++] = by_node[from[n] + round];
+	free(by_node);
+	free(from);
+	return 0;
+}
+
+void topo_free(topology *t){
+	free(t->cpus);
+	free(t->compact);
+	free(t->spread);
+	free(t->nodes);
+	memset(t, 0, sizeof *t);
+}
+
+int topo_place(const topology *t, int policy, int i){
+	const int *order = policy == TOPO_SPREAD ? t->spread : t->compact;
+	return t->cpus[order[i % t->ncpus]].cpu;
+}
+
+int topo_node_of(const topology *t, int cpu){
+	for (int i = 0; i < t->ncpus; i++)
+		if(t->cpus[i].cpu == cpu)
+			return t->cpus[i].node;
+	return 0;
+}
+
+int topo_pin(pthread_t thread, int cpu){
+	cpu_set_t one;
+	CPU_ZERO(&one);
+	CPU_SET(cpu, &one);
+	return pthread_setaffinity_np(thread, sizeof one, &one);
+}
+
+int topo_pin_self(int cpu){
+	return topo_pin(pthread_self(), cpu);
+}
+
+void *topo_alloc(size_t size, int node){
+	void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(p == MAP_FAILED)
+		return NULL;
+	if(node < 0){
+		unsigned cpu, here;
+		node = syscall(SYS_getcpu, &cpu, &here, NULL) == 0 ? (int)here : 0;
+	}
+	/* MPOL_PREFERRED: the node while it has room, elsewhere after
+	   that rather than failing. Without NUMA in the kernel this is
+	   ENOSYS and first touch below does what it can */
+	unsigned long mask[CPU_SETSIZE / (8 * sizeof(unsigned long))] = { 0 };
+	if(node < CPU_SETSIZE){
+		mask[node / (8 * sizeof *mask)] = 1UL << node % (8 * sizeof *mask);
+		syscall(SYS_mbind, p, size, MPOL_PREFERRED, mask, CPU_SETSIZE, 0);
+	}
+	long page = sysconf(_SC_PAGESIZE);
+	for (size_t off = 0; off < size; off += page)
+		((volatile char *)p)[off] = 0;
+	return p;
+}
+
+void topo_release(void *p, size_t size){
+	munmap(p, size);
+}
@@ -0,0 +1,62 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+/* which CPUs there are and how they hang together, from
+   /sys/devices/system/cpu and /sys/devices/system/node, and putting
+   threads and their memory in the right place with it.
+
+	topology t;
+	topo_load(&t);
+	for (int i = 0; i < n; i++)
+		cpu[i] = topo_place(&t, TOPO_SPREAD, i);
+	...in thread i:
+	topo_pin_self(cpu[i]);
+	double *mine = topo_alloc(size, topo_node_of(&t, cpu[i]));
+
+   Only the CPUs this process may run on count. A machine (or kernel)
+   without NUMA is one node 0, and everything still works.
+
+   TOPO_COMPACT packs threads close together: both hyperthreads of a
+   core, then the next core of the same node, then the next node. Good
+   when the threads share data. TOPO_SPREAD goes round the nodes, and
+   within a node takes a thread of every core before any core's second
+   one. Good for memory bandwidth: every thread gets its own core and
+   the most memory controllers are busy.
+
+   gcc -pthread ... topology.c */
+#include <pthread.h>
+#include <stddef.h>
+
+enum { TOPO_COMPACT, TOPO_SPREAD };
+
+typedef struct{
+	int cpu, core, package, node;
+	int sibling;            /* 0 for the first hyperthread of its core, 1 ... */
+}topo_cpu;
+
+typedef struct{
+	int ncpus, ncores, npackages, nnodes;
+	topo_cpu *cpus;         /* by node, package, core, cpu */
+	int *compact, *spread;  /* indices into cpus in placement order */
+	int *nodes;             /* node numbers, nnodes of them */
+}topology;
+
+/* 0, or -1 with errno set */
+int topo_load(topology *t);
+void topo_free(topology *t);
+
+/* CPU number for the i-th of the threads to place (i wraps around) */
+int topo_place(const topology *t, int policy, int i);
+int topo_node_of(const topology *t, int cpu);
+
+/* pthread_setaffinity_np to just that CPU, 0 or an errno value */
+int topo_pin(pthread_t thread, int cpu);
+int topo_pin_self(int cpu);
+
+/* size bytes on memory node node (-1: the node the caller runs on),
+   page aligned and already faulted in there. mbind where the kernel
+   has it, first touch by the caller where it doesn't, so for the
+   latter the caller should be pinned to that node. NULL on failure */
+void *topo_alloc(size_t size, int node);
+void topo_release(void *p, size_t size);
+
+#endif
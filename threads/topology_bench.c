@@ -0,0 +1,184 @@
+/* memory bandwidth by where the thread runs and where its memory is.
+
+	./topology_bench [MiB per thread] [threads]
+
+   1. what topology.c found, and the order the two policies hand out
+      CPUs in.
+   2. one thread on each node reading and writing a buffer on each
+      node: the diagonal is local memory, the rest remote. One node
+      (most laptops, VMs, single socket servers) is a 1 x 1 table.
+   3. [threads] threads (default one per CPU) placed compact and
+      spread, each streaming through its own buffer, with the buffers
+      on the node of the thread that uses them (allocated after
+      pinning) and with all of them on the first node, as a program
+      gets when one thread allocates everything. Read GB/s for all
+      threads together, best of 3.
+
+   gcc -O2 -pthread topology_bench.c topology.c -o topology_bench */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "topology.h"
+
+#define RUNS 3
+
+static topology topo;
+static size_t size;
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long read_all(const long *p, size_t n){
+	long s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	for (size_t i = 0; i < n; i += 4){
+		s0 += p[i];
+		s1 += p[i + 1];
+		s2 += p[i + 2];
+		s3 += p[i + 3];
+	}
+	return s0 + s1 + s2 + s3;
+}
+
+static volatile long sink;
+
+/* GB/s, best of RUNS */
+static double read_rate(const void *buf){
+	double best = 0;
+	for (int r = 0; r < RUNS; r++){
+		double t0 = now();
+		sink += read_all(buf, size / sizeof(long));
+		double rate = size / (now() - t0) / 1e9;
+		if(rate > best)
+			best = rate;
+	}
+	return best;
+}
+
+static double write_rate(void *buf){
+	double best = 0;
+	for (int r = 0; r < RUNS; r++){
+		double t0 = now();
+		memset(buf, r + 1, size);
+		double rate = size / (now() - t0) / 1e9;
+		if(rate > best)
+			best = rate;
+	}
+	return best;
+}
+
+static int first_cpu_of(int node){
+	for (int i = 0; i < topo.ncpus; i++)
+		if(topo.cpus[i].node == node)
+			return topo.cpus[i].cpu;
+	return topo.cpus[0].cpu;
+}
+
+typedef struct{
+	int cpu;
+	int local;              /* allocate after pinning, else use buf */
+	void *buf;
+	pthread_barrier_t *ready, *go;
+	double secs;
+}job;
+
+static void *streamer(void *arg){
+	job *j = arg;
+	topo_pin_self(j->cpu);
+	if(j->local)
+		j->buf = topo_alloc(size, -1);
+	pthread_barrier_wait(j->ready);
+	pthread_barrier_wait(j->go);
+	double t0 = now();
+	sink += read_all(j->buf, size / sizeof(long));
+	j->secs = now() - t0;
+	return NULL;
+}
+
+/* all n threads reading at once, GB/s together */
+static double together(int policy, int local, int n){
+	double best = 0;
+	job *jobs = calloc(n, sizeof *jobs);
+	pthread_t *threads = calloc(n, sizeof *threads);
+	pthread_barrier_t ready, go;
+	for (int r = 0; r < RUNS; r++){
+		pthread_barrier_init(&ready, NULL, n + 1);
+		pthread_barrier_init(&go, NULL, n + 1);
+		for (int i = 0; i < n; i++){
+			jobs[i] = (job){ topo_place(&topo, policy, i), local, NULL, &ready, &go, 0 };
+			if(!local)
+				jobs[i].buf = topo_alloc(size, topo.nodes[0]);
+			pthread_create(&threads[i], NULL, streamer, &jobs[i]);
+		}
+		pthread_barrier_wait(&ready);
+		double t0 = now();
+		pthread_barrier_wait(&go);
+		for (int i = 0; i < n; i++)
+			pthread_join(threads[i], NULL);
+		double rate = (double)size * n / (now() - t0) / 1e9;
+		if(rate > best)
+			best = rate;
+		for (int i = 0; i < n; i++)
+			topo_release(jobs[i].buf, size);
+		pthread_barrier_destroy(&ready);
+		pthread_barrier_destroy(&go);
+	}
+	free(jobs);
+	free(threads);
+	return best;
+}
+
+int main(int argc, char *argv[]){
+	size = (size_t)(argc > 1 ? atol(argv[1]) : 256) << 20;
+	if(topo_load(&topo) == -1){
+		perror("topo_load");
+		return 1;
+	}
+	int n = argc > 2 ? atoi(argv[2]) : topo.ncpus;
+
+	printf("%d CPUs, %d cores, %d packages, %d nodes\n", topo.ncpus, topo.ncores, topo.npackages, topo.nnodes);
+	printf("%-8s", "compact");
+	for (int i = 0; i < topo.ncpus && i < 32; i++)
+		printf(" %d", topo_place(&topo, TOPO_COMPACT, i));
+	printf("\n%-8s", "spread");
+	for (int i = 0; i < topo.ncpus && i < 32; i++)
+		printf(" %d", topo_place(&topo, TOPO_SPREAD, i));
+	printf("\n\none thread, GB/s read / write (rows: thread's node, columns: memory's node)\n%8s", "");
+	for (int m = 0; m < topo.nnodes; m++)
+		printf("   node %-10d", topo.nodes[m]);
+	putchar('\n');
+	for (int c = 0; c < topo.nnodes; c++){
+		topo_pin_self(first_cpu_of(topo.nodes[c]));
+		printf("node %-3d", topo.nodes[c]);
+		for (int m = 0; m < topo.nnodes; m++){
+			void *buf = topo_alloc(size, topo.nodes[m]);
+			if(buf == NULL){
+				perror("topo_alloc");
+				return 1;
+			}
+			double rd = read_rate(buf), wr = write_rate(buf);
+			printf("   %6.1f / %-6.1f", rd, wr);
+			topo_release(buf, size);
+		}
+		putchar('\n');
+	}
+
+	/* back to every CPU for the main thread */
+	cpu_set_t all;
+	CPU_ZERO(&all);
+	for (int i = 0; i < topo.ncpus; i++)
+		CPU_SET(topo.cpus[i].cpu, &all);
+	pthread_setaffinity_np(pthread_self(), sizeof all, &all);
+
+	printf("\n%d threads, GB/s read together\n", n);
+	printf("%-10s %14s %14s\n", "", "local memory", "all on node 0");
+	printf("%-10s %14.1f %14.1f\n", "compact", together(TOPO_COMPACT, 1, n), together(TOPO_COMPACT, 0, n));
+	printf("%-10s %14.1f %14.1f\n", "spread", together(TOPO_SPREAD, 1, n), together(TOPO_SPREAD, 0, n));
+	topo_free(&topo);
+	return 0;
+}
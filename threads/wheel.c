@@ -0,0 +1,280 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "wheel.h"
+
+#define LEVELS 6
+#define SLOT_BITS 6
+#define SLOTS (1 << SLOT_BITS)
+#define MAX_DELTA (1ULL << (LEVELS * SLOT_BITS))
+#define DUE 255                 /* level of a timer taken off the wheel to fire */
+
+struct wheel{
+	pthread_mutex_t lock;
+	pthread_cond_t callback_done;
+	uint64_t tick_ns;
+	uint64_t start_ns;              /* tick 0 */
+	uint64_t now;                   /* last tick that was dealt with */
+	uint64_t armed;                 /* tick the timerfd is set for, UINT64_MAX none */
+
+	wheel_timer slots[LEVELS][SLOTS];       /* list heads */
+	uint64_t occupied[LEVELS];              /* bit per non-empty slot */
+	wheel_timer due;
+
+	wheel_timer *running;
+	int running_cancelled, stop;
+	int fd;
+	pthread_t thread;
+};
+
+static uint64_t clock_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void list_init(wheel_timer *head){
+	head->next = head->prev = head;
+}
+
+static void list_add(wheel_timer *head, wheel_timer *t){
+	t->prev = head->prev;
+	t->next = head;
+	head->prev->next = t;
+	head->prev = t;
+}
+
+static void unlink_timer(wheel *w, wheel_timer *t){
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	if(t->level != DUE && w->slots[t->level][t->slot].next == &w->slots[t->level][t->slot])
+		w->occupied[t->level] &= ~(1ULL << t->slot);
+	t->pending = 0;
+}
+
+/* the level whose slots are just fine enough for how far off it is */
+static void place(wheel *w, wheel_timer *t){
+	uint64_t delta = t->expires - w->now;
+	uint64_t at = t->expires;
+	if(delta >= MAX_DELTA)
+		at = w->now + MAX_DELTA - 1;    /* comes back down in time to be placed again */
+	int level = 0;
+	while(level < LEVELS - 1 && (at - w->now) >> (SLOT_BITS * (level + 1)))
+		level++;
+	int slot = (at >> (SLOT_BITS * level)) & (SLOTS - 1);
+	t->level = level;
+	t->slot = slot;
+	t->pending = 1;
+	list_add(&w->slots[level][slot], t);
+	w->occupied[level] |= 1ULL << slot;
+}
+
+static void arm(wheel *w, uint64_t tick){
+	if(tick == w->armed)
+		return;
+	struct itimerspec its = { 0 };
+	if(tick != UINT64_MAX){
+		uint64_t at = w->start_ns + tick * w->tick_ns;
+		its.it_value.tv_sec = at / 1000000000;
+		its.it_value.tv_nsec = at % 1000000000;
+	}
+	timerfd_settime(w->fd, TFD_TIMER_ABSTIME, &its, NULL);
+	w->armed = tick;
+}
+
+/* the first tick after now that has a timer to fire or a slot to move
+   down, UINT64_MAX if the wheel is empty */
+static uint64_t next_event(wheel *w){
+	uint64_t next = UINT64_MAX;
+	for (int level = 0; level < LEVELS; level++){
+		uint64_t occ = w->occupied[level];
+		if(occ == 0)
+			continue;
+		int shift = SLOT_BITS * level;
+		uint64_t pos = (w->now >> shift) + 1;
+		int from = pos & (SLOTS - 1);
+		uint64_t rotated = occ >> from | (from ? occ << (SLOTS - from) : 0);
+		uint64_t at = (pos + __builtin_ctzll(rotated)) << shift;
+		if(at < next)
+			next = at;
+	}
+	return next;
+}
+
+static void cascade(wheel *w, int level, int slot){
+	wheel_timer *head = &w->slots[level][slot];
+	wheel_timer *t = head->next;
+	list_init(head);
+	w->occupied[level] &= ~(1ULL << slot);
+	while(t != head){
+		wheel_timer *next = t->next;
+		place(w, t);
+		t = next;
+	}
+}
+
+/* deal with every tick up to target: move timers down as their slot
+   comes up, collect what is due on w->due */
+static void advance(wheel *w, uint64_t target){
+	while(w->now < target){
+		if(w->occupied[0] == 0){
+			/* nothing happens until the next slot of the first
+			   non-empty level comes up */
+			int level = 1;
+			while(level < LEVELS && w->occupied[level] == 0)
+				level++;
+			if(level == LEVELS){
+				w->now = target;
+				break;
+			}
+			int shift = SLOT_BITS * level;
+			uint64_t next = ((w->now >> shift) + 1) << shift;
+			if(next > target){
+				w->now = target;
+				break;
+			}
+			w->now = next - 1;
+		}
+		uint64_t now = ++w->now;
+		for (int level = 1; level < LEVELS; level++){
+			int shift = SLOT_BITS * level;
+			if(now & ((1ULL << shift) - 1))
+				break;
+			cascade(w, level, (now >> shift) & (SLOTS - 1));
+		}
+		int slot = now & (SLOTS - 1);
+		wheel_timer *head = &w->slots[0][slot];
+		while(head->next != head){
+			wheel_timer *t = head->next;
+			t->prev->next = t->next;
+			t->next->prev = t->prev;
+			t->level = DUE;
+			list_add(&w->due, t);
+		}
+		w->occupied[0] &= ~(1ULL << slot);
+	}
+}
+
+static void fire_due(wheel *w){
+	while(w->due.next != &w->due){
+		wheel_timer *t = w->due.next;
+		unlink_timer(w, t);
+		uint64_t period = t->period;
+		w->running = t;
+		w->running_cancelled = 0;
+		pthread_mutex_unlock(&w->lock);
+		t->fn(t, t->arg);
+		pthread_mutex_lock(&w->lock);
+		/* t may be gone by now unless it is periodic and wasn't
+		   cancelled */
+		if(period && !w->running_cancelled && !t->pending){
+			if(t->expires + period <= w->now)
+				t->expires += (w->now - t->expires) / period * period;
+			t->expires += period;
+			place(w, t);
+		}
+		w->running = NULL;
+		pthread_cond_broadcast(&w->callback_done);
+	}
+}
+
+static void *wheel_main(void *arg){
+	wheel *w = arg;
+	pthread_mutex_lock(&w->lock);
+	while(!w->stop){
+		pthread_mutex_unlock(&w->lock);
+		uint64_t expirations;
+		if(read(w->fd, &expirations, sizeof expirations) == -1 && errno != EINTR && errno != EAGAIN)
+			abort();
+		pthread_mutex_lock(&w->lock);
+		if(w->stop)
+			break;
+		w->armed = UINT64_MAX;
+		advance(w, (clock_ns() - w->start_ns) / w->tick_ns);
+		fire_due(w);
+		arm(w, next_event(w));
+	}
+	pthread_mutex_unlock(&w->lock);
+	return NULL;
+}
+
+wheel *wheel_create(uint64_t tick_ns){
+	wheel *w = calloc(1, sizeof *w);
+	if(w == NULL)
+		return NULL;
+	w->tick_ns = tick_ns ? tick_ns : 1000000;
+	w->start_ns = clock_ns();
+	w->armed = UINT64_MAX;
+	for (int level = 0; level < LEVELS; level++)
+		for (int slot = 0; slot < SLOTS; slot++)
+			list_init(&w->slots[level][slot]);
+	list_init(&w->due);
+	w->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if(w->fd == -1){
+		free(w);
+		return NULL;
+	}
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->callback_done, NULL);
+	int err = pthread_create(&w->thread, NULL, wheel_main, w);
+	if(err){
+		close(w->fd);
+		pthread_mutex_destroy(&w->lock);
+		pthread_cond_destroy(&w->callback_done);
+		free(w);
+		errno = err;
+		return NULL;
+	}
+	return w;
+}
+
+void wheel_destroy(wheel *w){
+	pthread_mutex_lock(&w->lock);
+	w->stop = 1;
+	arm(w, 0);              /* long past, so it goes off right away */
+	pthread_mutex_unlock(&w->lock);
+	pthread_join(w->thread, NULL);
+	close(w->fd);
+	pthread_mutex_destroy(&w->lock);
+	pthread_cond_destroy(&w->callback_done);
+	free(w);
+}
+
+void wheel_start(wheel *w, wheel_timer *t, uint64_t delay_ns, uint64_t period_ns, wheel_fn fn, void *arg){
+	uint64_t deadline = clock_ns() + delay_ns - w->start_ns;
+	pthread_mutex_lock(&w->lock);
+	if(t->pending)
+		unlink_timer(w, t);
+	t->fn = fn;
+	t->arg = arg;
+	t->period = period_ns ? (period_ns + w->tick_ns - 1) / w->tick_ns : 0;
+	t->expires = (deadline + w->tick_ns - 1) / w->tick_ns;
+	if(t->expires <= w->now)
+		t->expires = w->now + 1;
+	place(w, t);
+	if(t->expires < w->armed)
+		arm(w, t->expires);
+	pthread_mutex_unlock(&w->lock);
+}
+
+int wheel_cancel(wheel *w, wheel_timer *t){
+	int stopped = 0;
+	pthread_mutex_lock(&w->lock);
+	if(t->pending){
+		unlink_timer(w, t);
+		stopped = 1;
+	}
+	if(w->running == t){
+		if(t->period && !w->running_cancelled)
+			stopped = 1;
+		w->running_cancelled = 1;
+		if(!pthread_equal(pthread_self(), w->thread))
+			while(w->running == t)
+				pthread_cond_wait(&w->callback_done, &w->lock);
+	}
+	pthread_mutex_unlock(&w->lock);
+	return stopped;
+}
@@ -0,0 +1,63 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+/* timers without a thread sleeping in a loop for each of them.
+   thread_creation.c paces its threads with it, wheel_hello.c has the
+   callbacks do the work.
+
+	static void tick(wheel_timer *t, void *arg){ ... }
+	wheel *w = wheel_create(0);
+	wheel_timer t;
+	wheel_start(w, &t, 2000000000, 2000000000, tick, NULL);
+	...
+	wheel_cancel(w, &t);
+	wheel_destroy(w);
+
+   All timers of a wheel sit in a hierarchical timing wheel (6 levels
+   of 64 slots, the first a slot per tick, each next one 64 times
+   coarser) so starting and cancelling one is a list insert or unlink
+   whatever the number of timers. One thread per wheel sleeps on a
+   timerfd set for the next tick that has anything to do, moves timers
+   down the levels as their time comes closer and runs the callbacks.
+
+   Deadlines are rounded up to the tick (1 ms by default), so timers
+   never fire early and all of those due in the same tick fire in one
+   wake-up, late by at most a tick plus the wake-up itself.
+
+   The wheel_timer is the caller's, zeroed before its first start, and
+   must stay put while it is started. Start and cancel from any
+   thread, the callbacks included; starting a started timer restarts
+   it. A callback may free its own timer if it is a one shot, or after
+   cancelling it.
+
+   gcc -pthread ... wheel.c */
+#include <stdint.h>
+
+typedef struct wheel wheel;
+typedef struct wheel_timer wheel_timer;
+typedef void (*wheel_fn)(wheel_timer *t, void *arg);
+
+struct wheel_timer{
+	wheel_timer *next, *prev;
+	uint64_t expires;               /* tick */
+	uint64_t period;                /* ticks, 0 for a one shot */
+	wheel_fn fn;
+	void *arg;
+	unsigned char level, slot, pending;
+};
+
+/* tick_ns 0 for 1 ms. NULL with errno set on failure */
+wheel *wheel_create(uint64_t tick_ns);
+/* timers still pending are forgotten, none of them fires */
+void wheel_destroy(wheel *w);
+
+/* fn(t, arg) on the wheel's thread in delay_ns, then every period_ns
+   if that is not 0 (at a multiple of it from the first deadline, a
+   period missed is skipped) */
+void wheel_start(wheel *w, wheel_timer *t, uint64_t delay_ns, uint64_t period_ns, wheel_fn fn, void *arg);
+
+/* 1 if that stopped a firing to come, 0 if there was none. If the
+   callback is running it waits for it to return, unless called from
+   the callback itself */
+int wheel_cancel(wheel *w, wheel_timer *t);
+
+#endif
@@ -0,0 +1,167 @@
+/* wheel.c with a lot of timers: what starting, cancelling and firing
+   one costs, and how late they fire.
+
+	./wheel_bench [timers]
+
+   1. start `timers` (default a million) timers 10 to 1000 s out, then
+      cancel them all in another order: ns per call.
+   2. start as many again, due 10 ms to 2 s out, and let them fire:
+      CPU time of the wheel's thread per timer (the callback only
+      notes the time), and how late they fired, in percentiles.
+   3. the same with a thousand timers, each mostly alone in its tick,
+      so every one of them is a wake-up of its own; with the default
+      1 ms tick and with a 100 us one.
+   4. a 10 ms periodic timer that cancels itself on its 100th call.
+
+   gcc -O2 -pthread wheel_bench.c wheel.c -o wheel_bench */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "wheel.h"
+
+typedef struct{
+	wheel_timer t;
+	uint64_t deadline;
+}timed;
+
+static timed *timers;
+static int64_t *late;
+static long fired;
+static struct timespec cpu_first, cpu_last;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t all_fired = PTHREAD_COND_INITIALIZER;
+static long expected;
+static int done;
+
+static uint64_t state = 88172645463325252ULL;
+
+static uint64_t next(void){
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static uint64_t clock_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double now(void){
+	return clock_ns() / 1e9;
+}
+
+static void never(wheel_timer *t, void *arg){
+	(void)t;
+	(void)arg;
+	abort();
+}
+
+/* only ever on the wheel's thread, one at a time */
+static void note(wheel_timer *t, void *arg){
+	timed *tm = (timed *)t;
+	(void)arg;
+	if(fired == 0)
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_first);
+	late[fired++] = (int64_t)(clock_ns() - tm->deadline);
+	if(fired == expected){
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_last);
+		pthread_mutex_lock(&lock);
+		done = 1;
+		pthread_cond_signal(&all_fired);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+static int by_value(const void *a, const void *b){
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return (x > y) - (x < y);
+}
+
+/* n timers due within spread_ns, wait for all of them */
+static void fire(const char *label, long n, uint64_t tick_ns, uint64_t spread_ns){
+	wheel *w = wheel_create(tick_ns);
+	if(w == NULL){
+		perror("wheel_create");
+		exit(1);
+	}
+	fired = 0;
+	expected = n;
+	done = 0;
+	pthread_mutex_lock(&lock);
+	for (long i = 0; i < n; i++){
+		uint64_t delay = 10000000 + next() % spread_ns;
+		timers[i] = (timed){ .deadline = clock_ns() + delay };
+		wheel_start(w, &timers[i].t, delay, 0, note, NULL);
+	}
+	while(!done)
+		pthread_cond_wait(&all_fired, &lock);
+	pthread_mutex_unlock(&lock);
+	wheel_destroy(w);
+
+	double cpu = (cpu_last.tv_sec - cpu_first.tv_sec) + (cpu_last.tv_nsec - cpu_first.tv_nsec) / 1e9;
+	qsort(late, n, sizeof *late, by_value);
+	printf("%-24s %8ld %10.0f ns %9.1f %9.1f %9.1f %9.1f %9.1f\n", label, n, cpu / n * 1e9,
+	       late[0] / 1e3, late[n / 2] / 1e3, late[n * 99 / 100] / 1e3, late[n * 999 / 1000] / 1e3, late[n - 1] / 1e3);
+}
+
+static int periodic_calls;
+static uint64_t periodic_first, periodic_last;
+
+static void every_10ms(wheel_timer *t, void *arg){
+	wheel *w = arg;
+	uint64_t ns = clock_ns();
+	if(periodic_calls++ == 0)
+		periodic_first = ns;
+	periodic_last = ns;
+	if(periodic_calls == 100 && wheel_cancel(w, t) != 1)
+		printf("WRONG: cancelling a running periodic timer stopped nothing\n");
+}
+
+int main(int argc, char *argv[]){
+	long n = argc > 1 ? atol(argv[1]) : 1000000;
+	timers = calloc(n, sizeof *timers);
+	late = malloc(n * sizeof *late);
+	if(timers == NULL || late == NULL){
+		perror("malloc");
+		return 1;
+	}
+
+	wheel *w = wheel_create(0);
+	if(w == NULL){
+		perror("wheel_create");
+		return 1;
+	}
+	double t0 = now();
+	for (long i = 0; i < n; i++)
+		wheel_start(w, &timers[i].t, 10000000000ULL + next() % 990000000000ULL, 0, never, NULL);
+	double start_t = now() - t0;
+	long stopped = 0;
+	t0 = now();
+	for (long i = 0; i < n; i++)
+		stopped += wheel_cancel(w, &timers[(i * 7919) % n].t);
+	double cancel_t = now() - t0;
+	wheel_destroy(w);
+	printf("%ld timers: wheel_start %.1f ns, wheel_cancel %.1f ns%s\n\n", n, start_t / n * 1e9,
+	       cancel_t / n * 1e9, stopped == n ? "" : " (WRONG: some weren't pending)");
+
+	printf("%-24s %8s %13s %9s %9s %9s %9s %9s\n", "", "timers", "cpu/timer", "", "", "late, us", "", "");
+	printf("%-24s %8s %13s %9s %9s %9s %9s %9s\n", "", "", "", "min", "p50", "p99", "p99.9", "max");
+	fire("within 2 s, 1 ms tick", n, 0, 2000000000);
+	long few = n < 1000 ? n : 1000;
+	fire("1000 in 2 s, 1 ms tick", few, 0, 2000000000);
+	fire("1000 in 2 s, 100 us tick", few, 100000, 2000000000);
+
+	w = wheel_create(0);
+	wheel_timer every = { 0 };
+	wheel_start(w, &every, 10000000, 10000000, every_10ms, w);
+	usleep(1200000);
+	wheel_destroy(w);
+	printf("\n10 ms periodic: %d calls, %.3f ms apart on average\n", periodic_calls,
+	       (periodic_last - periodic_first) / 1e6 / (periodic_calls - 1));
+	return stopped != n || periodic_calls != 100;
+}
@@ -0,0 +1,47 @@
+/* two "threads" saying hello every 2 seconds, 16 times each, like
+   thread_creation.c, but with no thread of their own: they are two
+   periodic timers whose callbacks run on the timer wheel's one thread,
+   which sleeps until a timer is due.
+
+   gcc -pthread wheel_hello.c wheel.c */
+#include <semaphore.h>
+#include <stdio.h>
+#include "wheel.h"
+
+#define SECONDS 1000000000ULL
+
+typedef struct{
+	wheel_timer timer;
+	const char *name;
+	int counter;
+}hello;
+
+static wheel *w;
+static sem_t finished;
+
+static void say_hello(wheel_timer *t, void *arg){
+	hello *h = arg;
+	printf("hello from thread  %s.\n", h->name);
+	fflush(stdout);
+	if(++h->counter > 15){
+		wheel_cancel(w, t);
+		sem_post(&finished);
+	}
+}
+
+int main(void){
+	hello one = { .name = "one" }, two = { .name = "two" };
+	sem_init(&finished, 0, 0);
+	w = wheel_create(0);
+	if(w == NULL){
+		perror("wheel_create");
+		return 1;
+	}
+	wheel_start(w, &one.timer, 0, 2 * SECONDS, say_hello, &one);
+	wheel_start(w, &two.timer, 0, 2 * SECONDS, say_hello, &two);
+
+	sem_wait(&finished);
+	sem_wait(&finished);
+	wheel_destroy(w);
+	return 0;
+}
@@ -2,22 +2,114 @@
    It will focus on a simple custom printf function
    It is supposed to enhance understanding of the variadic functions
    in c language
+
+   The numbers are turned into text by fmt_num.c instead of being
+   handed back to printf, the output collects in a buffer and goes
+   out with fwrite.
+
+   gcc custom_printf.c fmt_num.c -o custom_printf
  */
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <string.h>
+#include "fmt_num.h"
+
+#define OUT_SIZE 256
+
+static void out(char *buf, int *used, const char *s, int n){
+	if(*used + n > OUT_SIZE){
+		fwrite(buf, 1, *used, stdout);
+		*used = 0;
+	}
+	if(n > OUT_SIZE){
+		fwrite(s, 1, n, stdout);
+		return;
+	}
+	memcpy(buf + *used, s, n);
+	*used += n;
+}
 
 int custom_printf(char *fmt, ...){
 	int count = 0;
 	va_list arguments;
 	va_start(arguments, fmt);
-	
+
+	char buf[OUT_SIZE], num[320];     /* %f of DBL_MAX is 316 */
+	int used = 0, n;
 	int  fmt_length = strlen(fmt);
-	while (true)
+	for (int i = 0; i < fmt_length; i++)
 	{
-		/* i,d = int, s = string, f = float, d = double, o = octal, c = character 
+		/* i,d = int, s = string, f = float, d = double, o = octal, c = character
 		   we have c for character but i guess it is graduated to int
 		   and flaot to double i think
 		 */
-	    i
+		if(fmt[i] != '%' || i + 1 == fmt_length){
+			out(buf, &used, fmt + i, 1);
+			count++;
+			continue;
+		}
+		switch(fmt[++i]){
+			case 'i':
+			case 'd':{
+				int value = va_arg(arguments, int);
+				n = 0;
+				if(value < 0)
+					num[n++] = '-';
+				n += fmt_u64_dec(num + n, value < 0 ? -(int64_t)value : value);
+				break;
+			}
+			case 'o':
+				n = fmt_u64_oct(num, va_arg(arguments, unsigned));
+				break;
+			case 'x':
+				n = fmt_u64_hex(num, va_arg(arguments, unsigned), 0);
+				break;
+			case 'f':{
+				double value = va_arg(arguments, double);
+				n = 0;
+				if(value < 0){
+					num[n++] = '-';
+					value = -value;
+				}
+				int len = fmt_double(num + n, sizeof num - n, value, 'f', 6, 0);
+				/* too big for our buffer or too many digits: ask printf after all */
+				n = len < 0 ? snprintf(num, sizeof num, "%f", n ? -value : value) : n + len;
+				break;
+			}
+			case 'c':
+				num[0] = (char)va_arg(arguments, int);
+				n = 1;
+				break;
+			case 's':{
+				char *s = va_arg(arguments, char *);
+				n = strlen(s);
+				out(buf, &used, s, n);
+				count += n;
+				continue;
+			}
+			case '%':
+				num[0] = '%';
+				n = 1;
+				break;
+			default:
+				num[0] = '%';
+				num[1] = fmt[i];
+				n = 2;
+				break;
+		}
+		out(buf, &used, num, n);
+		count += n;
+	}
+	fwrite(buf, 1, used, stdout);
+	va_end(arguments);
+	return count;
+}
+
+int main(void){
+	int n = custom_printf("%s is %d, %o in octal, %x in hex, %c%c %f%%\n",
+			      "ninety", 90, 90, 90, 'o', 'k', -12.5);
+	custom_printf("that was %d characters\n", n);
+	return 0;
+}
@@ -0,0 +1,647 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dlog.h"
+#include "mini_format.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define DEFAULT_RING (1 << 20)
+#define MIN_RING (1 << 16)
+#define OUTBUF (1 << 16)
+#define MAGIC "DLOG1\0\0\0"
+/* after what could be printed of a record whose arguments don't fit */
+#define BAD_ARGS " [dlog: arguments don't fit the format]\n"
+
+/* everything in a ring and in the binary log is a record, 8 byte aligned */
+enum { REC_PAD = 0xffffffffu, REC_SITE = 0xfffffffeu };
+
+typedef struct{
+	uint32_t id;            /* site, or REC_PAD: skip to the ring's end */
+	uint32_t size;          /* whole record, header included */
+	uint64_t ticks;
+}rec_header;
+
+/* what a tick is: rdtsc where there is one, nanoseconds otherwise */
+typedef struct{
+	char magic[8];
+	uint64_t ticks0;
+	int64_t real0;          /* CLOCK_REALTIME ns at ticks0 */
+	double ns_per_tick;
+}log_header;
+
+/* single producer (its thread), single consumer (the background thread).
+   head and tail only grow, the index is pos & (size - 1) */
+typedef struct ring{
+	_Alignas(64) _Atomic size_t head;
+	_Alignas(64) _Atomic size_t tail;
+	_Alignas(64) size_t cached_tail;
+	char *buf;
+	size_t size;
+	_Atomic int closed;     /* its thread is gone, free once drained */
+	struct ring *next;
+}ring;
+
+static struct{
+	dlog_options opt;
+	log_header clock;
+	pthread_t thread;
+	_Atomic int running, stop, flush_req;
+	pthread_mutex_t lock;   /* rings list and sites */
+	ring *rings;
+	dlog_site *sites[DLOG_MAX_SITES];
+	uint32_t nsites;
+	pthread_key_t key;
+	_Atomic unsigned generation;    /* one more with every dlog_init */
+}g = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* my_ring is only good if my_generation is still g.generation, a
+   dlog_shutdown since then has freed it */
+static _Thread_local ring *my_ring;
+static _Thread_local unsigned my_generation;
+
+static uint64_t ticks(void){
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static int64_t clock_ns(clockid_t id){
+	struct timespec ts;
+	clock_gettime(id, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void calibrate(log_header *h){
+	memcpy(h->magic, MAGIC, sizeof h->magic);
+	int64_t m0 = clock_ns(CLOCK_MONOTONIC);
+	h->ticks0 = ticks();
+	h->real0 = clock_ns(CLOCK_REALTIME);
+#if defined(__x86_64__) || defined(__i386__)
+	struct timespec ten_ms = { 0, 10000000 };
+	nanosleep(&ten_ms, NULL);
+	int64_t m1 = clock_ns(CLOCK_MONOTONIC);
+	h->ns_per_tick = (double)(m1 - m0) / (ticks() - h->ticks0);
+#else
+	(void)m0;
+	h->ns_per_tick = 1;
+#endif
+}
+
+static size_t round8(size_t n){
+	return (n + 7) & ~(size_t)7;
+}
+
+static size_t arg_size(const dlog_arg *a){
+	if(a->type == DLOG_STR)
+		return 4 + strnlen(a->str ? a->str : "(null)", DLOG_MAX_STR);
+	return a->type == DLOG_I32 ? 4 : 8;
+}
+
+static char *put_arg(char *p, const dlog_arg *a){
+	switch(a->type){
+		case DLOG_I32: memcpy(p, &a->i32, 4); return p + 4;
+		case DLOG_I64: memcpy(p, &a->i64, 8); return p + 8;
+		case DLOG_F64: memcpy(p, &a->f64, 8); return p + 8;
+		case DLOG_PTR: memcpy(p, &a->ptr, 8); return p + 8;
+	}
+	const char *s = a->str ? a->str : "(null)";
+	uint32_t n = strnlen(s, DLOG_MAX_STR);
+	memcpy(p, &n, 4);
+	memcpy(p + 4, s, n);
+	return p + 4 + n;
+}
+
+/* bytes an argument of this type takes in a record, at p; -1 if that
+   runs past end (a string says its own length), so bad data is caught
+   before anything is copied */
+static long arg_bytes(int type, const char *p, const char *end){
+	uint32_t n;
+	switch(type){
+		case DLOG_I32: return end - p >= 4 ? 4 : -1;
+		case DLOG_I64:
+		case DLOG_F64:
+		case DLOG_PTR: return end - p >= 8 ? 8 : -1;
+		case DLOG_STR:
+			if(end - p < 4)
+				return -1;
+			memcpy(&n, p, 4);
+			return n <= DLOG_MAX_STR && (size_t)(end - p - 4) >= n ? 4 + (long)n : -1;
+	}
+	return -1;
+}
+
+/* the integer at p, of an argument known to be I32 or I64 */
+static int64_t get_int(int type, const char *p){
+	if(type == DLOG_I32){
+		int32_t i;
+		memcpy(&i, p, 4);
+		return i;
+	}
+	int64_t v;
+	memcpy(&v, p, 8);
+	return v;
+}
+
+static int is_int(int type){
+	return type == DLOG_I32 || type == DLOG_I64;
+}
+
+/* the type a conversion letter needs, ints being either width */
+static int conv_fits(char conv, int type){
+	if(strchr("diouxXc", conv))
+		return is_int(type);
+	if(strchr("eEfFgGaA", conv))
+		return type == DLOG_F64;
+	return conv == 's' ? type == DLOG_STR : type == DLOG_PTR;
+}
+
+/* spec with its length modifier replaced by the one the recorded type
+   needs: "ll" for I64, h/hh kept for I32, none for anything else */
+static void fix_length(char *spec, size_t len, int type){
+	char conv = spec[len - 1], mod[3] = "";
+	size_t at = strcspn(spec, "hlLqjzt");
+	if(type == DLOG_I64)
+		strcpy(mod, "ll");
+	else if(type == DLOG_I32 && spec[at] == 'h')
+		strcpy(mod, spec[at + 1] == 'h' ? "hh" : "h");
+	if(at > len - 1)
+		at = len - 1;
+	strcpy(spec + at, mod);
+	at += strlen(mod);
+	spec[at] = conv;
+	spec[at + 1] = '\0';
+}
+
+/* one conversion with its arguments, * first */
+#define FORMAT_ONE(v) (nstar == 0 ? mini_format(out, spec, v)                 \
+		       : nstar == 1 ? mini_format(out, spec, star[0], v)        \
+		       : mini_format(out, spec, star[0], star[1], v))
+
+/* the arguments are in [p, end); -1 if they don't fit there, or don't
+   fit the conversions that use them (a * takes an int, %s a string ...) */
+static int format_args(sink *out, const char *fmt, const unsigned char *types, int nargs,
+		       const char *p, const char *end){
+	char spec[32], str[DLOG_MAX_STR + 1];
+	int a = 0;
+	for (const char *q = p; a < nargs; a++){
+		long n = arg_bytes(types[a], q, end);
+		if(n == -1)
+			return -1;
+		q += n;
+	}
+	a = 0;
+	while(*fmt){
+		const char *pct = strchr(fmt, '%');
+		if(pct == NULL){
+			sink_put(out, fmt, strlen(fmt));
+			return 0;
+		}
+		sink_put(out, fmt, pct - fmt);
+		const char *conv = pct + 1;
+		while(*conv && strchr("diouxXeEfFgGaAcsp%n", *conv) == NULL)
+			conv++;
+		size_t len = conv + 1 - pct;
+		if(*conv == '%'){
+			sink_put(out, "%", 1);
+			fmt = conv + 1;
+			continue;
+		}
+		int nstar = 0;
+		for (const char *c = pct; c < conv; c++)
+			nstar += *c == '*';
+		/* %n, or nothing left to print it with: as written */
+		if(*conv == '\0' || *conv == 'n' || len >= sizeof spec - 2 || a + nstar >= nargs){
+			sink_put(out, pct, *conv ? len : len - 1);
+			fmt = *conv ? conv + 1 : conv;
+			continue;
+		}
+		fmt = conv + 1;
+		if(nstar > 2)
+			return -1;
+		int star[2];
+		for (int i = 0; i < nstar; i++, a++){
+			if(!is_int(types[a]))
+				return -1;
+			star[i] = get_int(types[a], p);
+			p += arg_bytes(types[a], p, end);
+		}
+		int type = types[a++];
+		if(!conv_fits(*conv, type))
+			return -1;
+		memcpy(spec, pct, len);
+		spec[len] = '\0';
+		fix_length(spec, len, type);
+		long size = arg_bytes(type, p, end);
+		if(size == -1)
+			return -1;
+		switch(type){
+			case DLOG_I32:
+				FORMAT_ONE((int)get_int(type, p));
+				break;
+			case DLOG_I64:
+				FORMAT_ONE((long long)get_int(type, p));
+				break;
+			case DLOG_F64:{
+				double v;
+				memcpy(&v, p, 8);
+				FORMAT_ONE(v);
+				break;
+			}
+			case DLOG_PTR:{
+				void *v;
+				memcpy(&v, p, 8);
+				FORMAT_ONE(v);
+				break;
+			}
+			case DLOG_STR:
+				/* size - 4 <= DLOG_MAX_STR, arg_bytes saw to it */
+				memcpy(str, p + 4, size - 4);
+				str[size - 4] = '\0';
+				FORMAT_ONE(str);
+				break;
+		}
+		p += size;
+	}
+	return 0;
+}
+
+/* "hh:mm:ss.uuuuuu " then the message; -1 if the record is bad */
+static int format_record(sink *out, const log_header *clk, const dlog_site *site,
+			 const rec_header *h){
+	int64_t ns = clk->real0 + (int64_t)((double)(int64_t)(h->ticks - clk->ticks0) * clk->ns_per_tick);
+	time_t secs = ns / 1000000000;
+	struct tm tm;
+	localtime_r(&secs, &tm);
+	mini_format(out, "%02d:%02d:%02d.%06d ", tm.tm_hour, tm.tm_min, tm.tm_sec,
+		    (int)(ns % 1000000000 / 1000));
+	return format_args(out, site->fmt, site->types, site->nargs, (const char *)(h + 1),
+			   (const char *)h + h->size);
+}
+
+void dlog_check_format(const char *fmt, ...){
+	(void)fmt;
+}
+
+static void register_site(dlog_site *site, const dlog_arg *args, int nargs){
+	pthread_mutex_lock(&g.lock);
+	if(__atomic_load_n(&site->id, __ATOMIC_ACQUIRE) == 0 && g.nsites + 1 < DLOG_MAX_SITES){
+		site->nargs = nargs;
+		for (int i = 0; i < nargs; i++)
+			site->types[i] = args[i].type;
+		g.sites[++g.nsites] = site;
+		__atomic_store_n(&site->id, g.nsites, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&g.lock);
+}
+
+static void close_ring(void *arg){
+	atomic_store_explicit(&((ring *)arg)->closed, 1, memory_order_release);
+}
+
+static ring *new_ring(void){
+	ring *r = calloc(1, sizeof *r);
+	if(r == NULL || (r->buf = malloc(g.opt.ring_size)) == NULL){
+		free(r);
+		return NULL;
+	}
+	r->size = g.opt.ring_size;
+	memset(r->buf, 0, r->size);     /* page faults now, not in DLOG */
+	pthread_mutex_lock(&g.lock);
+	r->next = g.rings;
+	g.rings = r;
+	pthread_mutex_unlock(&g.lock);
+	pthread_setspecific(g.key, r);
+	return r;
+}
+
+/* not running: format right here */
+static void write_now(dlog_site *site, const dlog_arg *args, int nargs){
+	char buf[DLOG_MAX_STR], rec[DLOG_MAX_ARGS * (4 + DLOG_MAX_STR)];
+	char *p = rec;
+	sink out;
+	dlog_site local = *site;
+	local.nargs = nargs;
+	for (int i = 0; i < nargs; i++){
+		local.types[i] = args[i].type;
+		p = put_arg(p, &args[i]);
+	}
+	sink_fd(&out, STDERR_FILENO, buf, sizeof buf);
+	if(format_args(&out, local.fmt, local.types, local.nargs, rec, p) == -1)
+		sink_put(&out, BAD_ARGS, sizeof BAD_ARGS - 1);
+	sink_finish(&out);
+}
+
+void dlog_write(dlog_site *site, const dlog_arg *args, int nargs){
+	if(!atomic_load_explicit(&g.running, memory_order_acquire)){
+		write_now(site, args, nargs);
+		return;
+	}
+	if(__atomic_load_n(&site->id, __ATOMIC_ACQUIRE) == 0)
+		register_site(site, args, nargs);
+	unsigned generation = atomic_load_explicit(&g.generation, memory_order_relaxed);
+	ring *r = my_generation == generation ? my_ring : NULL;
+	if(site->id == 0 || (r == NULL && (r = new_ring()) == NULL)){
+		write_now(site, args, nargs);
+		return;
+	}
+	my_ring = r;
+	my_generation = generation;
+
+	size_t need = sizeof(rec_header);
+	for (int i = 0; i < nargs; i++)
+		need += arg_size(&args[i]);
+	need = round8(need);
+
+	size_t pos = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t off = pos & (r->size - 1);
+	size_t pad = off + need > r->size ? r->size - off : 0;
+	/* full: wait for the background thread, like a blocking write would */
+	while(pos + pad + need - r->cached_tail > r->size){
+		r->cached_tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+		if(pos + pad + need - r->cached_tail > r->size)
+			sched_yield();
+	}
+	if(pad){
+		/* may be only 8 bytes, so just id and size */
+		uint32_t skip[2] = { REC_PAD, pad };
+		memcpy(r->buf + off, skip, sizeof skip);
+		off = 0;
+	}
+	rec_header *h = (rec_header *)(r->buf + off);
+	h->id = site->id;
+	h->size = need;
+	h->ticks = ticks();
+	char *p = (char *)(h + 1);
+	for (int i = 0; i < nargs; i++)
+		p = put_arg(p, &args[i]);
+	atomic_store_explicit(&r->head, pos + pad + need, memory_order_release);
+}
+
+/* the next record of r, past any padding, or NULL */
+static rec_header *peek(ring *r){
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+	while(tail != head){
+		rec_header *h = (rec_header *)(r->buf + (tail & (r->size - 1)));
+		if(h->id != REC_PAD)
+			return h;
+		tail += h->size;
+		atomic_store_explicit(&r->tail, tail, memory_order_release);
+	}
+	return NULL;
+}
+
+static void emit(sink *out, unsigned char *defined, rec_header *h){
+	dlog_site *site = g.sites[h->id];
+	if(!g.opt.binary){
+		if(format_record(out, &g.clock, site, h) == -1)
+			sink_put(out, BAD_ARGS, sizeof BAD_ARGS - 1);
+		return;
+	}
+	/* a site goes out before its first record */
+	if(!defined[h->id]){
+		size_t flen = strlen(site->fmt) + 1, llen = strlen(site->file) + 1;
+		size_t size = round8(sizeof(rec_header) + 8 + site->nargs + flen + llen);
+		char def[sizeof(rec_header) + 8 + DLOG_MAX_ARGS] = { 0 };
+		rec_header dh = { REC_SITE, size, 0 };
+		uint16_t line = site->line, nargs = site->nargs;
+		memcpy(def, &dh, sizeof dh);
+		memcpy(def + sizeof dh, &h->id, 4);
+		memcpy(def + sizeof dh + 4, &line, 2);
+		memcpy(def + sizeof dh + 6, &nargs, 2);
+		memcpy(def + sizeof dh + 8, site->types, site->nargs);
+		sink_put(out, def, sizeof dh + 8 + site->nargs);
+		sink_put(out, site->fmt, flen);
+		sink_put(out, site->file, llen);
+		sink_put(out, "\0\0\0\0\0\0\0", size - (sizeof dh + 8 + site->nargs + flen + llen));
+		defined[h->id] = 1;
+	}
+	sink_put(out, (const char *)h, h->size);
+}
+
+/* oldest record first across all the rings */
+static int drain(sink *out, unsigned char *defined){
+	int done = 0;
+	for (;;){
+		ring *best = NULL;
+		rec_header *oldest = NULL;
+		pthread_mutex_lock(&g.lock);
+		for (ring **pp = &g.rings; *pp; ){
+			ring *r = *pp;
+			rec_header *h = peek(r);
+			if(h == NULL && atomic_load_explicit(&r->closed, memory_order_acquire)
+			   && peek(r) == NULL){
+				*pp = r->next;
+				free(r->buf);
+				free(r);
+				continue;
+			}
+			if(h && (oldest == NULL || (int64_t)(h->ticks - oldest->ticks) < 0)){
+				oldest = h;
+				best = r;
+			}
+			pp = &r->next;
+		}
+		pthread_mutex_unlock(&g.lock);
+		if(best == NULL)
+			return done;
+		emit(out, defined, oldest);
+		atomic_fetch_add_explicit(&best->tail, oldest->size, memory_order_release);
+		done++;
+	}
+}
+
+static void *background(void *arg){
+	static unsigned char defined[DLOG_MAX_SITES];
+	char buf[OUTBUF];
+	sink out;
+	(void)arg;
+	memset(defined, 0, sizeof defined);
+	sink_fd(&out, g.opt.fd, buf, sizeof buf);
+	if(g.opt.binary)
+		sink_put(&out, (const char *)&g.clock, sizeof g.clock);
+	for (;;){
+		int stopping = atomic_load_explicit(&g.stop, memory_order_acquire);
+		if(drain(&out, defined) == 0){
+			sink_flush(&out);
+			if(atomic_load_explicit(&g.flush_req, memory_order_acquire))
+				atomic_store_explicit(&g.flush_req, 0, memory_order_release);
+			if(stopping)
+				break;
+			struct timespec ms = { 0, 1000000 };
+			nanosleep(&ms, NULL);
+		}
+	}
+	sink_finish(&out);
+	return NULL;
+}
+
+int dlog_init(const dlog_options *opt){
+	g.opt = *opt;
+	if(g.opt.ring_size == 0)
+		g.opt.ring_size = DEFAULT_RING;
+	if(g.opt.ring_size < MIN_RING || (g.opt.ring_size & (g.opt.ring_size - 1))){
+		errno = EINVAL;
+		return -1;
+	}
+	calibrate(&g.clock);
+	if(pthread_key_create(&g.key, close_ring) != 0)
+		return -1;
+	atomic_store(&g.stop, 0);
+	atomic_fetch_add(&g.generation, 1);
+	atomic_store(&g.running, 1);
+	if((errno = pthread_create(&g.thread, NULL, background, NULL)) != 0){
+		atomic_store(&g.running, 0);
+		return -1;
+	}
+	return 0;
+}
+
+void dlog_flush(void){
+	struct{
+		ring *r;
+		size_t head;
+	}*want = NULL;
+	int n = 0;
+	if(!atomic_load(&g.running))
+		return;
+	/* a ring that is gone from the list was drained before it went */
+	for (;;){
+		int behind = 0;
+		pthread_mutex_lock(&g.lock);
+		if(want == NULL){
+			for (ring *r = g.rings; r; r = r->next)
+				n++;
+			if((want = malloc(n * sizeof *want)) == NULL){
+				pthread_mutex_unlock(&g.lock);
+				return;
+			}
+			n = 0;
+			for (ring *r = g.rings; r; r = r->next, n++){
+				want[n].r = r;
+				want[n].head = atomic_load(&r->head);
+			}
+		}
+		for (ring *r = g.rings; r; r = r->next)
+			for (int i = 0; i < n; i++)
+				if(want[i].r == r && atomic_load(&r->tail) < want[i].head)
+					behind = 1;
+		pthread_mutex_unlock(&g.lock);
+		if(!behind)
+			break;
+		sched_yield();
+	}
+	free(want);
+	atomic_store(&g.flush_req, 1);
+	while(atomic_load(&g.flush_req))
+		sched_yield();
+}
+
+void dlog_shutdown(void){
+	if(!atomic_load(&g.running))
+		return;
+	atomic_store(&g.stop, 1);
+	pthread_join(g.thread, NULL);
+	atomic_store(&g.running, 0);
+	for (ring *r = g.rings, *next; r; r = next){
+		next = r->next;
+		free(r->buf);
+		free(r);
+	}
+	g.rings = NULL;
+	pthread_key_delete(g.key);
+}
+
+static int read_all(int fd, void *buf, size_t n){
+	for (size_t done = 0; done < n; ){
+		ssize_t m = read(fd, (char *)buf + done, n - done);
+		if(m == -1 && errno == EINTR)
+			continue;
+		if(m == 0 && done > 0)
+			errno = EINVAL;         /* cut off in the middle */
+		if(m <= 0)
+			return done == 0 && m == 0 ? 0 : -1;
+		done += m;
+	}
+	return 1;
+}
+
+int dlog_decode(int in, int out){
+	log_header clk;
+	static dlog_site sites[DLOG_MAX_SITES];
+	static char rec[sizeof(rec_header) + DLOG_MAX_ARGS * (4 + DLOG_MAX_STR) + 8];
+	char buf[OUTBUF];
+	sink text;
+	int status;
+
+	if(read_all(in, &clk, sizeof clk) != 1 || memcmp(clk.magic, MAGIC, sizeof clk.magic) != 0){
+		errno = EINVAL;
+		return -1;
+	}
+	sink_fd(&text, out, buf, sizeof buf);
+	rec_header *h = (rec_header *)rec;
+	while((status = read_all(in, h, sizeof *h)) == 1){
+		if(h->size < sizeof *h || h->size > sizeof rec){
+			errno = EINVAL;
+			status = -1;
+			break;
+		}
+		if(read_all(in, h + 1, h->size - sizeof *h) != 1){
+			status = -1;
+			break;
+		}
+		if(h->id == REC_SITE){
+			const char *p = (const char *)(h + 1);
+			uint32_t id = 0;
+			uint16_t line, nargs = 0;
+			if(h->size >= sizeof *h + 8){
+				memcpy(&id, p, 4);
+				memcpy(&line, p + 4, 2);
+				memcpy(&nargs, p + 6, 2);
+			}
+			if(id == 0 || id >= DLOG_MAX_SITES || nargs > DLOG_MAX_ARGS
+			   || h->size < sizeof *h + 8 + nargs){
+				errno = EINVAL;
+				status = -1;
+				break;
+			}
+			/* format and file, both '\0' terminated, then padding */
+			size_t len = h->size - sizeof *h - 8 - nargs;
+			char *text_ = malloc(len + 2);
+			if(text_ == NULL){
+				status = -1;
+				break;
+			}
+			memcpy(text_, p + 8 + nargs, len);
+			text_[len] = text_[len + 1] = '\0';
+			dlog_site *s = &sites[id];
+			free((char *)s->fmt);
+			s->fmt = text_;
+			s->file = text_ + strlen(text_) + 1;
+			s->line = line;
+			s->nargs = nargs;
+			memcpy(s->types, p + 8, nargs);
+			s->id = id;
+		}else if(h->id >= DLOG_MAX_SITES || sites[h->id].id == 0
+			 || format_record(&text, &clk, &sites[h->id], h) == -1){
+			errno = EINVAL;
+			status = -1;
+			break;
+		}
+	}
+	sink_finish(&text);
+	return status == -1 ? -1 : 0;
+}
@@ -0,0 +1,115 @@
+#ifndef DLOG_H
+#define DLOG_H
+/* deferred logging: DLOG(fmt, ...) doesn't format anything. The call
+   site has a static record of its format string, the arguments are
+   copied as raw bytes into a ring buffer of the calling thread, and a
+   background thread turns them into text later (or writes them out
+   as they are, for dlog_decode).
+
+	DLOG("took %d ms for %s\n", ms, name);
+
+   The argument types are worked out at compile time with _Generic:
+   integers up to int as 4 bytes, long and long long as 8, float and
+   double as a double, char * as the string's bytes (copied, at most
+   DLOG_MAX_STR of them), any other pointer as its value. At most
+   DLOG_MAX_ARGS arguments; * width and precision count as arguments.
+   The format is checked against the arguments like printf's.
+
+   Before dlog_init (or after dlog_shutdown) DLOG formats on the spot
+   to stderr, so nothing is lost, it is only slower.
+
+   dlog_shutdown frees every thread's ring, so no other thread may be
+   inside DLOG while it runs (join or quiet them first). Threads that
+   log afterwards, or after a new dlog_init, get a fresh ring.
+
+   gcc ... dlog.c mini_format.c fmt_num.c -pthread */
+#include <stddef.h>
+#include <stdint.h>
+
+#define DLOG_MAX_ARGS 10
+#define DLOG_MAX_STR 4096
+#define DLOG_MAX_SITES 4096
+
+enum { DLOG_I32 = 1, DLOG_I64, DLOG_F64, DLOG_STR, DLOG_PTR };
+
+typedef struct{
+	int type;
+	union{
+		int32_t i32;
+		int64_t i64;
+		double f64;
+		const char *str;
+		const void *ptr;
+	};
+}dlog_arg;
+
+/* one per DLOG call site, registered the first time it runs */
+typedef struct{
+	const char *fmt, *file;
+	int line;
+	uint32_t id;            /* 0 until registered */
+	int nargs;
+	unsigned char types[DLOG_MAX_ARGS];
+}dlog_site;
+
+typedef struct{
+	int fd;                 /* text, or with binary the records for dlog_decode */
+	int binary;
+	size_t ring_size;       /* per thread, a power of two, default 1 MiB */
+}dlog_options;
+
+int dlog_init(const dlog_options *opt);
+/* returns once everything logged so far has been written */
+void dlog_flush(void);
+void dlog_shutdown(void);
+
+/* binary log from dlog_init with binary set -> text, as the background
+   thread would have written it. 0, or -1 on a read error or bad data */
+int dlog_decode(int in, int out);
+
+void dlog_write(dlog_site *site, const dlog_arg *args, int nargs);
+void dlog_check_format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static inline dlog_arg dlog_i32(int32_t v){ return (dlog_arg){ .type = DLOG_I32, .i32 = v }; }
+static inline dlog_arg dlog_i64(int64_t v){ return (dlog_arg){ .type = DLOG_I64, .i64 = v }; }
+static inline dlog_arg dlog_f64(double v){ return (dlog_arg){ .type = DLOG_F64, .f64 = v }; }
+static inline dlog_arg dlog_str(const char *v){ return (dlog_arg){ .type = DLOG_STR, .str = v }; }
+static inline dlog_arg dlog_ptr(const void *v){ return (dlog_arg){ .type = DLOG_PTR, .ptr = v }; }
+
+#define DLOG_ARG(x) _Generic((x),                                               \
+	_Bool: dlog_i32, char: dlog_i32, signed char: dlog_i32, unsigned char: dlog_i32, \
+	short: dlog_i32, unsigned short: dlog_i32, int: dlog_i32, unsigned: dlog_i32, \
+	long: dlog_i64, unsigned long: dlog_i64,                                \
+	long long: dlog_i64, unsigned long long: dlog_i64,                      \
+	float: dlog_f64, double: dlog_f64,                                      \
+	char *: dlog_str, const char *: dlog_str,                               \
+	default: dlog_ptr)(x)
+
+/* how many arguments after the format, and DLOG_ARG over each of them */
+#define DLOG_COUNT(...) DLOG_COUNT_(__VA_ARGS__, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_COUNT_(f, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, n, ...) n
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b) a##b
+#define DLOG_ARGS_0(f)
+#define DLOG_ARGS_1(f, a) , DLOG_ARG(a)
+#define DLOG_ARGS_2(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_1(f, __VA_ARGS__)
+#define DLOG_ARGS_3(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_2(f, __VA_ARGS__)
+#define DLOG_ARGS_4(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_3(f, __VA_ARGS__)
+#define DLOG_ARGS_5(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_4(f, __VA_ARGS__)
+#define DLOG_ARGS_6(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_5(f, __VA_ARGS__)
+#define DLOG_ARGS_7(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_6(f, __VA_ARGS__)
+#define DLOG_ARGS_8(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_7(f, __VA_ARGS__)
+#define DLOG_ARGS_9(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_8(f, __VA_ARGS__)
+#define DLOG_ARGS_10(f, a, ...) , DLOG_ARG(a) DLOG_ARGS_9(f, __VA_ARGS__)
+
+/* args_[0] is only there so the initializer is never empty */
+#define DLOG(...) do{                                                           \
+	static dlog_site dlog_site_ = { .fmt = DLOG_FIRST(__VA_ARGS__), .file = __FILE__, .line = __LINE__ }; \
+	dlog_arg dlog_args_[] = { { 0 } DLOG_CAT(DLOG_ARGS_, DLOG_COUNT(__VA_ARGS__))(__VA_ARGS__) }; \
+	if(0)                                                                   \
+		dlog_check_format(__VA_ARGS__);                                 \
+	dlog_write(&dlog_site_, dlog_args_ + 1, DLOG_COUNT(__VA_ARGS__));       \
+}while(0)
+#define DLOG_FIRST(f, ...) f
+
+#endif
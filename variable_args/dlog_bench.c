@@ -0,0 +1,118 @@
+/* what a warning() costs at the call site: the old fprintf(stderr, ...)
+   against DLOG, which only copies the arguments. For DLOG also the
+   time until the background thread has written everything out.
+
+	./dlog_bench [calls] [threads]
+
+   stderr is pointed at /dev/null for the run, the table goes to
+   stdout. ns/call is CPU time of the calling threads, so it stays
+   honest when the background thread shares a core with them;
+   ns/line total is wall time until all of it is written. The rings
+   are made big enough that no call has to wait for the background
+   thread; with the default 1 MiB a burst longer than the ring runs at
+   the speed of the formatting again.
+
+   gcc -O2 -pthread dlog_bench.c dlog.c mini_format.c fmt_num.c -o dlog_bench */
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "dlog.h"
+#include "mini_format.h"
+
+enum { FPRINTF, MINI_FPRINTF, DLOG_TEXT, DLOG_BINARY };
+
+static const char *names[] = { "fprintf(stderr)", "mini_fprintf(stderr)", "DLOG text", "DLOG binary" };
+static long calls;
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double thread_cpu(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct{
+	int how;
+	double cpu;
+}job;
+
+/* the warning() from printf_like_function.c and a busier line */
+static void *logger(void *arg){
+	job *j = arg;
+	int how = j->how;
+	double cpu = thread_cpu();
+	for (long i = 0; i < calls; i++){
+		switch(how){
+			case FPRINTF:
+				fprintf(stderr, "Hey there how are you i am %i year %s.\n", 21, "old");
+				fprintf(stderr, "req %ld took %.3f ms, %d bytes from %s\n", i, i / 7.0, (int)i & 4095, "10.0.0.1");
+				break;
+			case MINI_FPRINTF:
+				mini_fprintf(stderr, "Hey there how are you i am %i year %s.\n", 21, "old");
+				mini_fprintf(stderr, "req %ld took %.3f ms, %d bytes from %s\n", i, i / 7.0, (int)i & 4095, "10.0.0.1");
+				break;
+			default:
+				DLOG("Hey there how are you i am %i year %s.\n", 21, "old");
+				DLOG("req %ld took %.3f ms, %d bytes from %s\n", i, i / 7.0, (int)i & 4095, "10.0.0.1");
+				break;
+		}
+	}
+	j->cpu = thread_cpu() - cpu;
+	return NULL;
+}
+
+static void run(int how, int nthreads){
+	pthread_t threads[64];
+	job jobs[64];
+	if(how >= DLOG_TEXT){
+		/* 2 records of at most 64 bytes per call */
+		size_t ring = 1 << 16;
+		while(ring < (size_t)calls * 128)
+			ring <<= 1;
+		dlog_options opt = { STDERR_FILENO, how == DLOG_BINARY, ring };
+		if(dlog_init(&opt) == -1){
+			perror("dlog_init");
+			exit(EXIT_FAILURE);
+		}
+	}
+	double t0 = now();
+	double calling = 0;
+	for (int t = 0; t < nthreads; t++){
+		jobs[t].how = how;
+		pthread_create(&threads[t], NULL, logger, &jobs[t]);
+	}
+	for (int t = 0; t < nthreads; t++){
+		pthread_join(threads[t], NULL);
+		calling += jobs[t].cpu;
+	}
+	if(how >= DLOG_TEXT){
+		dlog_flush();
+		dlog_shutdown();
+	}
+	double total = now() - t0;
+	long n = 2 * calls * nthreads;
+	printf("%-22s %10.1f %14.1f\n", names[how], calling / n * 1e9, total / n * 1e9);
+}
+
+int main(int argc, char *argv[]){
+	calls = argc > 1 ? atol(argv[1]) : 500000;
+	int nthreads = argc > 2 ? atoi(argv[2]) : 1;
+	int null = open("/dev/null", O_WRONLY);
+	if(null == -1 || dup2(null, STDERR_FILENO) == -1 || nthreads < 1 || nthreads > 64){
+		perror("/dev/null");
+		exit(EXIT_FAILURE);
+	}
+	printf("%ld lines from each of %d threads\n", 2 * calls, nthreads);
+	printf("%-22s %10s %14s\n", "", "ns/call", "ns/line total");
+	for (int how = FPRINTF; how <= DLOG_BINARY; how++)
+		run(how, nthreads);
+	return 0;
+}
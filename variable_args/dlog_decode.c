@@ -0,0 +1,24 @@
+/* turns a binary log from dlog (dlog_options.binary set) into text.
+
+	./dlog_decode log.bin > log.txt
+	./dlog_decode < log.bin
+
+   gcc -pthread dlog_decode.c dlog.c mini_format.c fmt_num.c -o dlog_decode */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "dlog.h"
+
+int main(int argc, char *argv[]){
+	int in = STDIN_FILENO;
+	if(argc > 1 && (in = open(argv[1], O_RDONLY)) == -1){
+		fprintf(stderr, "Can't open %s.\n", argv[1]);
+		exit(EXIT_FAILURE);
+	}
+	if(dlog_decode(in, STDOUT_FILENO) == -1){
+		perror(argc > 1 ? argv[1] : "stdin");
+		exit(EXIT_FAILURE);
+	}
+	return 0;
+}
@@ -0,0 +1,68 @@
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "fmt_generic.h"
+
+void fmt_put_double(sink *s, double v){
+	char out[FMT_SHORTEST_MAX];
+	fmt_put_bytes(s, out, fmt_double_shortest(out, v));
+}
+
+/* the first %.<p>g that strtof turns back into v. A float has at most
+   9 significant digits worth keeping, so that is where it stops */
+void fmt_put_float(sink *s, float v){
+	if(!isfinite(v) || v == 0){
+		fmt_put_double(s, v);
+		return;
+	}
+	char out[40];
+	int n = 0;
+	if(v < 0)
+		out[n++] = '-';
+	for (int p = 1; p <= 9; p++){
+		int len = fmt_double(out + n, sizeof out - n - 1, fabsf(v), 'g', p, 0);
+		if(len < 0)
+			len = snprintf(out + n, sizeof out - n, "%.*g", p, fabsf(v));
+		out[n + len] = '\0';
+		if(strtof(out + n, NULL) == fabsf(v) || p == 9){
+			n += len;
+			break;
+		}
+	}
+	fmt_put_bytes(s, out, n);
+}
+
+/* the same for long double with strtold, up to LDBL_DECIMAL_DIG digits
+   (21 for x87, 36 for quad). No fmt_num.c for it, so snprintf */
+void fmt_put_ldouble(sink *s, long double v){
+	if(!isfinite(v) || v == 0){
+		fmt_put_double(s, v);
+		return;
+	}
+	char out[64];
+	int len = 0;
+	for (int p = 1; p <= LDBL_DECIMAL_DIG; p++){
+		len = snprintf(out, sizeof out, "%.*Lg", p, v);
+		if(strtold(out, NULL) == v)
+			break;
+	}
+	fmt_put_bytes(s, out, len);
+}
+
+void fmt_put_fixed(sink *s, fmt_fixed_t f){
+	char out[360];  /* %f of DBL_MAX is 316, plus the precision */
+	if(!isfinite(f.v) || f.prec < 0 || f.prec > 40){
+		mini_format(s, "%.*f", f.prec, f.v);
+		return;
+	}
+	int n = 0;
+	if(signbit(f.v))
+		out[n++] = '-';
+	int len = fmt_double(out + n, sizeof out - n, fabs(f.v), 'f', f.prec, 0);
+	if(len < 0){
+		mini_format(s, "%.*f", f.prec, f.v);
+		return;
+	}
+	fmt_put_bytes(s, out, n + len);
+}
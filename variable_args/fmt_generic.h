@@ -0,0 +1,151 @@
+#ifndef FMT_GENERIC_H
+#define FMT_GENERIC_H
+/* printf without the format string: the pieces are given in order and
+   _Generic picks the conversion for each one when the code is compiled.
+
+	FMT(&s, "took ", ms, " ms for ", name, "\n");
+	int n = FMT_SNPRINTF(buf, sizeof buf, "x=", x, " y=", y);
+	FMT_PRINT("sizeof(f) = ", sizeof(f), "\n");
+
+   Nothing is parsed and there is no va_list, every piece is a direct
+   call into fmt_num.c and a memcpy into the sink. A type that doesn't
+   fit is a compile error instead of garbage, and sizeof comes out as
+   the size_t it is.
+
+   What each type prints as, the same bytes as printf with:
+	char                                %c
+	signed/unsigned char, short, int,
+	long, long long, _Bool              %d %u %ld %lu ... (the value)
+	char *, const char *                %s, "(null)" for NULL
+	any other pointer                   %p
+	double                              %.<n>g, the smallest n that reads back
+	float                               the same, reading back as a float
+	long double                         the same, reading back as a long double
+	FMT_HEX(v)                          %llx
+	FMT_FIXED(v, prec)                  %.<prec>f
+
+   A character constant like 'a' is an int in C and prints as 97, write
+   (char)'a' or "a" for the letter.
+
+   FMT takes 1 to 16 pieces. FMT_SNPRINTF and FMT_PRINT are statement
+   expressions (gcc, clang) and return what snprintf and mini_printf
+   would; FMT_PRINT writes to fd 1 past stdio, like mini_printf.
+
+   gcc ... fmt_generic.c mini_format.c fmt_num.c */
+#include <stdint.h>
+#include <string.h>
+#include "fmt_num.h"
+#include "mini_format.h"
+
+typedef struct{ unsigned long long v; }fmt_hex_t;
+typedef struct{ double v; int prec; }fmt_fixed_t;
+
+#define FMT_HEX(v) ((fmt_hex_t){ (unsigned long long)(v) })
+#define FMT_FIXED(v, prec) ((fmt_fixed_t){ (v), (prec) })
+
+void fmt_put_double(sink *s, double v);
+void fmt_put_float(sink *s, float v);
+void fmt_put_ldouble(sink *s, long double v);
+void fmt_put_fixed(sink *s, fmt_fixed_t f);
+
+/* straight into the buffer while it fits, the sink does the rest */
+static inline void fmt_put_bytes(sink *s, const char *p, size_t n){
+	if(n < s->cap - s->len){
+		memcpy(s->buf + s->len, p, n);
+		s->len += n;
+		s->total += n;
+	}else
+		sink_put(s, p, n);
+}
+
+static inline void fmt_put_u64(sink *s, unsigned long long v){
+	char num[FMT_DEC_MAX];
+	fmt_put_bytes(s, num, fmt_u64_dec(num, v));
+}
+
+static inline void fmt_put_i64(sink *s, long long v){
+	char num[FMT_DEC_MAX + 1];
+	int n = 0;
+	if(v < 0)
+		num[n++] = '-';
+	n += fmt_u64_dec(num + n, v < 0 ? -(uint64_t)v : (uint64_t)v);
+	fmt_put_bytes(s, num, n);
+}
+
+static inline void fmt_put_char(sink *s, char c){
+	fmt_put_bytes(s, &c, 1);
+}
+
+/* strlen of a string literal is worked out by the compiler */
+static inline void fmt_put_str(sink *s, const char *v){
+	if(v == NULL)
+		v = "(null)";
+	fmt_put_bytes(s, v, strlen(v));
+}
+
+static inline void fmt_put_ptr(sink *s, const void *v){
+	char num[2 + FMT_HEX_MAX] = "0x";
+	if(v == NULL)
+		fmt_put_bytes(s, "(nil)", 5);
+	else
+		fmt_put_bytes(s, num, 2 + fmt_u64_hex(num + 2, (uintptr_t)v, 0));
+}
+
+static inline void fmt_put_hex(sink *s, fmt_hex_t h){
+	char num[FMT_HEX_MAX];
+	fmt_put_bytes(s, num, fmt_u64_hex(num, h.v, 0));
+}
+
+#define FMT_PUT(s, x) _Generic((x),                                             \
+	char: fmt_put_char,                                                     \
+	_Bool: fmt_put_u64, unsigned char: fmt_put_u64, unsigned short: fmt_put_u64, \
+	unsigned: fmt_put_u64, unsigned long: fmt_put_u64, unsigned long long: fmt_put_u64, \
+	signed char: fmt_put_i64, short: fmt_put_i64, int: fmt_put_i64,         \
+	long: fmt_put_i64, long long: fmt_put_i64,                              \
+	float: fmt_put_float, double: fmt_put_double, long double: fmt_put_ldouble, \
+	char *: fmt_put_str, const char *: fmt_put_str,                         \
+	fmt_hex_t: fmt_put_hex, fmt_fixed_t: fmt_put_fixed,                     \
+	default: fmt_put_ptr)(s, x)
+
+/* FMT_PUT over each piece, at most 16 of them */
+#define FMT_COUNT(...) FMT_COUNT_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define FMT_COUNT_(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, n, ...) n
+#define FMT_CAT(a, b) FMT_CAT_(a, b)
+#define FMT_CAT_(a, b) a##b
+#define FMT_EACH_1(s, a) FMT_PUT(s, a);
+#define FMT_EACH_2(s, a, ...) FMT_PUT(s, a); FMT_EACH_1(s, __VA_ARGS__)
+#define FMT_EACH_3(s, a, ...) FMT_PUT(s, a); FMT_EACH_2(s, __VA_ARGS__)
+#define FMT_EACH_4(s, a, ...) FMT_PUT(s, a); FMT_EACH_3(s, __VA_ARGS__)
+#define FMT_EACH_5(s, a, ...) FMT_PUT(s, a); FMT_EACH_4(s, __VA_ARGS__)
+#define FMT_EACH_6(s, a, ...) FMT_PUT(s, a); FMT_EACH_5(s, __VA_ARGS__)
+#define FMT_EACH_7(s, a, ...) FMT_PUT(s, a); FMT_EACH_6(s, __VA_ARGS__)
+#define FMT_EACH_8(s, a, ...) FMT_PUT(s, a); FMT_EACH_7(s, __VA_ARGS__)
+#define FMT_EACH_9(s, a, ...) FMT_PUT(s, a); FMT_EACH_8(s, __VA_ARGS__)
+#define FMT_EACH_10(s, a, ...) FMT_PUT(s, a); FMT_EACH_9(s, __VA_ARGS__)
+#define FMT_EACH_11(s, a, ...) FMT_PUT(s, a); FMT_EACH_10(s, __VA_ARGS__)
+#define FMT_EACH_12(s, a, ...) FMT_PUT(s, a); FMT_EACH_11(s, __VA_ARGS__)
+#define FMT_EACH_13(s, a, ...) FMT_PUT(s, a); FMT_EACH_12(s, __VA_ARGS__)
+#define FMT_EACH_14(s, a, ...) FMT_PUT(s, a); FMT_EACH_13(s, __VA_ARGS__)
+#define FMT_EACH_15(s, a, ...) FMT_PUT(s, a); FMT_EACH_14(s, __VA_ARGS__)
+#define FMT_EACH_16(s, a, ...) FMT_PUT(s, a); FMT_EACH_15(s, __VA_ARGS__)
+
+#define FMT(s, ...) do{                                                         \
+	sink *fmt_s_ = (s);                                                     \
+	FMT_CAT(FMT_EACH_, FMT_COUNT(__VA_ARGS__))(fmt_s_, __VA_ARGS__)         \
+}while(0)
+
+#define FMT_SNPRINTF(buf, size, ...) ({                                         \
+	sink fmt_str_;                                                          \
+	sink_string(&fmt_str_, (buf), (size));                                  \
+	FMT(&fmt_str_, __VA_ARGS__);                                            \
+	sink_finish(&fmt_str_);                                                 \
+})
+
+#define FMT_PRINT(...) ({                                                       \
+	sink fmt_out_;                                                          \
+	sink_fd(&fmt_out_, 1, NULL, 0);                                         \
+	FMT(&fmt_out_, __VA_ARGS__);                                            \
+	sink_finish(&fmt_out_);                                                 \
+})
+
+#endif
@@ -0,0 +1,194 @@
+/* FMT against the printf family: the same bytes, without the format
+   string.
+
+	./fmt_generic_bench [values]
+
+   First every kind of piece FMT knows is checked against snprintf with
+   the matching conversion for `values` random values (default one
+   million). Then a few log-line shapes are timed, ns per line, with
+   snprintf, mini_snprintf and FMT_SNPRINTF into the same buffer. The
+   difference between the last two is the parsing and va_arg work,
+   the number formatting underneath is the same fmt_num.c.
+
+   gcc -O2 fmt_generic_bench.c fmt_generic.c mini_format.c fmt_num.c -o fmt_generic_bench */
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fmt_generic.h"
+#include "mini_format.h"
+
+#define TIMED 1000000
+
+static uint64_t state = 88172645463325252ULL;
+
+static uint64_t next(void){
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+static uint64_t random_int(void){
+	return next() >> (next() & 63);
+}
+
+static double random_double(long i){
+	if(i & 1){
+		double d;
+		uint64_t bits = next();
+		memcpy(&d, &bits, sizeof d);
+		return d;       /* nan and inf included */
+	}
+	static const double scale[] = { 1, 10, 100, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11 };
+	return (int64_t)random_int() / scale[next() % 12];
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long mismatches;
+
+static void compare(const char *what, const char *want, const char *got){
+	if(strcmp(want, got) != 0 && mismatches++ < 20)
+		printf("MISMATCH %-10s printf [%s] FMT [%s]\n", what, want, got);
+}
+
+#define CHECK(fmt, v) do{                                               \
+	char want[400], got[400];                                       \
+	__typeof__(v) v_ = (v);                                         \
+	snprintf(want, sizeof want, fmt, v_);                           \
+	FMT_SNPRINTF(got, sizeof got, v_);                              \
+	compare(fmt, want, got);                                        \
+}while(0)
+
+/* %.<n>g with the smallest n that reads back, by asking printf */
+static void shortest_double(char *out, double v){
+	for (int p = 1; p <= 17; p++){
+		sprintf(out, "%.*g", p, v);
+		if(strtod(out, NULL) == v || isnan(v))
+			return;
+	}
+}
+
+static void shortest_float(char *out, float v){
+	for (int p = 1; p <= 9; p++){
+		sprintf(out, "%.*g", p, v);
+		if(strtof(out, NULL) == v || isnan(v))
+			return;
+	}
+}
+
+static void shortest_ldouble(char *out, long double v){
+	for (int p = 1; p <= LDBL_DECIMAL_DIG; p++){
+		sprintf(out, "%.*Lg", p, v);
+		if(strtold(out, NULL) == v || isnan(v))
+			return;
+	}
+}
+
+static void check(long i){
+	uint64_t u = random_int();
+	int64_t d = (int64_t)u;
+	CHECK("%d", (int)d);
+	CHECK("%u", (unsigned)u);
+	CHECK("%hd", (short)d);
+	CHECK("%hhu", (unsigned char)u);
+	CHECK("%hhd", (signed char)d);
+	CHECK("%ld", (long)d);
+	CHECK("%lu", (unsigned long)u);
+	CHECK("%lld", (long long)d);
+	CHECK("%llu", (unsigned long long)u);
+	CHECK("%zu", (size_t)u);
+	CHECK("%c", (char)(' ' + u % 95));
+	CHECK("%p", (void *)(uintptr_t)(i & 7 ? u : 0));
+
+	char want[400], got[400];
+	snprintf(want, sizeof want, "%llx", (unsigned long long)u);
+	FMT_SNPRINTF(got, sizeof got, FMT_HEX(u));
+	compare("%llx", want, got);
+
+	double v = random_double(i);
+	shortest_double(want, v);
+	FMT_SNPRINTF(got, sizeof got, v);
+	compare("double", want, got);
+
+	long double ld = (long double)v / 3;
+	shortest_ldouble(want, ld);
+	FMT_SNPRINTF(got, sizeof got, ld);
+	compare("long double", want, got);
+
+	float f = (float)v;
+	shortest_float(want, f);
+	FMT_SNPRINTF(got, sizeof got, f);
+	compare("float", want, got);
+
+	int prec = next() % 20;
+	snprintf(want, sizeof want, "%.*f", prec, v);
+	FMT_SNPRINTF(got, sizeof got, FMT_FIXED(v, prec));
+	compare("%.*f", want, got);
+
+	const char *s = i & 15 ? "some text" : NULL;
+	snprintf(want, sizeof want, "[%s] %s", s ? s : "(null)", "tail");
+	FMT_SNPRINTF(got, sizeof got, "[", s, "] ", "tail");
+	compare("%s", want, got);
+}
+
+static int ints[TIMED];
+static double doubles[TIMED];
+
+#define TIME(label, expr) do{                                           \
+	double t0 = now();                                              \
+	long sum = 0;                                                   \
+	for (int i = 0; i < TIMED; i++)                                 \
+		sum += (expr);                                          \
+	printf("%-44s %8.1f ns  (%ld)\n", label, (now() - t0) / TIMED * 1e9, sum); \
+}while(0)
+
+int main(int argc, char *argv[]){
+	long n = argc > 1 ? atol(argv[1]) : 1000000;
+	double t0 = now();
+	for (long i = 0; i < n; i++)
+		check(i);
+	printf("checked %ld values of each kind in %.1f s: %ld mismatches\n", n, now() - t0, mismatches);
+
+	/* the truncation end of FMT_SNPRINTF */
+	char small[8];
+	int len = FMT_SNPRINTF(small, sizeof small, "x=", 1234567, " y=", -1);
+	if(len != 14 || strcmp(small, "x=12345") != 0){
+		printf("MISMATCH truncated: %d [%s]\n", len, small);
+		mismatches++;
+	}
+	putchar('\n');
+
+	for (int i = 0; i < TIMED; i++){
+		ints[i] = (int)random_int();
+		doubles[i] = random_double(i & ~1L);
+	}
+	char buf[400];
+	const char *name = "10.0.0.1";
+	TIME("snprintf \"x=%d y=%d\"", snprintf(buf, sizeof buf, "x=%d y=%d\n", ints[i], i));
+	TIME("mini_snprintf", mini_snprintf(buf, sizeof buf, "x=%d y=%d\n", ints[i], i));
+	TIME("FMT_SNPRINTF", FMT_SNPRINTF(buf, sizeof buf, "x=", ints[i], " y=", i, "\n"));
+	TIME("snprintf \"req %d took %.3f ms from %s\"",
+	     snprintf(buf, sizeof buf, "req %d took %.3f ms from %s\n", i, doubles[i], name));
+	TIME("mini_snprintf",
+	     mini_snprintf(buf, sizeof buf, "req %d took %.3f ms from %s\n", i, doubles[i], name));
+	TIME("FMT_SNPRINTF",
+	     FMT_SNPRINTF(buf, sizeof buf, "req ", i, " took ", FMT_FIXED(doubles[i], 3), " ms from ", name, "\n"));
+	TIME("snprintf \"[%zu] %s=%llx at %p\"",
+	     snprintf(buf, sizeof buf, "[%zu] %s=%llx at %p\n", sizeof buf, name, (unsigned long long)ints[i], (void *)buf));
+	TIME("mini_snprintf",
+	     mini_snprintf(buf, sizeof buf, "[%zu] %s=%llx at %p\n", sizeof buf, name, (unsigned long long)ints[i], (void *)buf));
+	TIME("FMT_SNPRINTF",
+	     FMT_SNPRINTF(buf, sizeof buf, "[", sizeof buf, "] ", name, "=", FMT_HEX(ints[i]), " at ", (void *)buf, "\n"));
+	TIME("snprintf \"v=%.17g\"", snprintf(buf, sizeof buf, "v=%.17g\n", doubles[i]));
+	TIME("FMT_SNPRINTF (shortest round trip)", FMT_SNPRINTF(buf, sizeof buf, "v=", doubles[i], "\n"));
+	return mismatches != 0;
+}
@@ -0,0 +1,371 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fmt_num.h"
+
+static const char two_digits[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const uint64_t pow10[20] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+	100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+	10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+int fmt_dec_len(uint64_t v){
+	/* 1233 / 4096 is just over log10(2) */
+	int t = (64 - __builtin_clzll(v | 1)) * 1233 >> 12;
+	return v == 0 ? 1 : t + 1 - (v < pow10[t]);
+}
+
+int fmt_u64_dec(char *out, uint64_t v){
+	int n = fmt_dec_len(v);
+	char *p = out + n;
+	while(v >= 100){
+		unsigned r = v % 100;
+		v /= 100;
+		p -= 2;
+		memcpy(p, two_digits + 2 * r, 2);
+	}
+	if(v >= 10)
+		memcpy(p - 2, two_digits + 2 * v, 2);
+	else
+		p[-1] = '0' + v;
+	return n;
+}
+
+int fmt_u64_hex(char *out, uint64_t v, int upper){
+	const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	int n = v ? (67 - __builtin_clzll(v)) / 4 : 1;
+	for (int i = n - 1; i >= 0; i--, v >>= 4)
+		out[i] = digits[v & 15];
+	return n;
+}
+
+int fmt_u64_oct(char *out, uint64_t v){
+	int n = v ? (66 - __builtin_clzll(v)) / 3 : 1;
+	for (int i = n - 1; i >= 0; i--, v >>= 3)
+		out[i] = '0' + (v & 7);
+	return n;
+}
+
+/* Grisu3, after Loitsch, "Printing Floating-Point Numbers Quickly and
+   Accurately with Integers" (PLDI 2010). A number is f * 2^e. */
+typedef struct{
+	uint64_t f;
+	int e;
+}diy_fp;
+
+/* 10^k for k = -348, -340, ... 340, rounded to 64 bits */
+static const struct{
+	uint64_t f;
+	short e, k;
+}cached_powers[] = {
+	{ 0xfa8fd5a0081c0288ULL, -1220, -348 }, { 0xbaaee17fa23ebf76ULL, -1193, -340 },
+	{ 0x8b16fb203055ac76ULL, -1166, -332 }, { 0xcf42894a5dce35eaULL, -1140, -324 },
+	{ 0x9a6bb0aa55653b2dULL, -1113, -316 }, { 0xe61acf033d1a45dfULL, -1087, -308 },
+	{ 0xab70fe17c79ac6caULL, -1060, -300 }, { 0xff77b1fcbebcdc4fULL, -1034, -292 },
+	{ 0xbe5691ef416bd60cULL, -1007, -284 }, { 0x8dd01fad907ffc3cULL, -980, -276 },
+	{ 0xd3515c2831559a83ULL, -954, -268 }, { 0x9d71ac8fada6c9b5ULL, -927, -260 },
+	{ 0xea9c227723ee8bcbULL, -901, -252 }, { 0xaecc49914078536dULL, -874, -244 },
+	{ 0x823c12795db6ce57ULL, -847, -236 }, { 0xc21094364dfb5637ULL, -821, -228 },
+	{ 0x9096ea6f3848984fULL, -794, -220 }, { 0xd77485cb25823ac7ULL, -768, -212 },
+	{ 0xa086cfcd97bf97f4ULL, -741, -204 }, { 0xef340a98172aace5ULL, -715, -196 },
+	{ 0xb23867fb2a35b28eULL, -688, -188 }, { 0x84c8d4dfd2c63f3bULL, -661, -180 },
+	{ 0xc5dd44271ad3cdbaULL, -635, -172 }, { 0x936b9fcebb25c996ULL, -608, -164 },
+	{ 0xdbac6c247d62a584ULL, -582, -156 }, { 0xa3ab66580d5fdaf6ULL, -555, -148 },
+	{ 0xf3e2f893dec3f126ULL, -529, -140 }, { 0xb5b5ada8aaff80b8ULL, -502, -132 },
+	{ 0x87625f056c7c4a8bULL, -475, -124 }, { 0xc9bcff6034c13053ULL, -449, -116 },
+	{ 0x964e858c91ba2655ULL, -422, -108 }, { 0xdff9772470297ebdULL, -396, -100 },
+	{ 0xa6dfbd9fb8e5b88fULL, -369, -92 }, { 0xf8a95fcf88747d94ULL, -343, -84 },
+	{ 0xb94470938fa89bcfULL, -316, -76 }, { 0x8a08f0f8bf0f156bULL, -289, -68 },
+	{ 0xcdb02555653131b6ULL, -263, -60 }, { 0x993fe2c6d07b7facULL, -236, -52 },
+	{ 0xe45c10c42a2b3b06ULL, -210, -44 }, { 0xaa242499697392d3ULL, -183, -36 },
+	{ 0xfd87b5f28300ca0eULL, -157, -28 }, { 0xbce5086492111aebULL, -130, -20 },
+	{ 0x8cbccc096f5088ccULL, -103, -12 }, { 0xd1b71758e219652cULL, -77, -4 },
+	{ 0x9c40000000000000ULL, -50, 4 }, { 0xe8d4a51000000000ULL, -24, 12 },
+	{ 0xad78ebc5ac620000ULL, 3, 20 }, { 0x813f3978f8940984ULL, 30, 28 },
+	{ 0xc097ce7bc90715b3ULL, 56, 36 }, { 0x8f7e32ce7bea5c70ULL, 83, 44 },
+	{ 0xd5d238a4abe98068ULL, 109, 52 }, { 0x9f4f2726179a2245ULL, 136, 60 },
+	{ 0xed63a231d4c4fb27ULL, 162, 68 }, { 0xb0de65388cc8ada8ULL, 189, 76 },
+	{ 0x83c7088e1aab65dbULL, 216, 84 }, { 0xc45d1df942711d9aULL, 242, 92 },
+	{ 0x924d692ca61be758ULL, 269, 100 }, { 0xda01ee641a708deaULL, 295, 108 },
+	{ 0xa26da3999aef774aULL, 322, 116 }, { 0xf209787bb47d6b85ULL, 348, 124 },
+	{ 0xb454e4a179dd1877ULL, 375, 132 }, { 0x865b86925b9bc5c2ULL, 402, 140 },
+	{ 0xc83553c5c8965d3dULL, 428, 148 }, { 0x952ab45cfa97a0b3ULL, 455, 156 },
+	{ 0xde469fbd99a05fe3ULL, 481, 164 }, { 0xa59bc234db398c25ULL, 508, 172 },
+	{ 0xf6c69a72a3989f5cULL, 534, 180 }, { 0xb7dcbf5354e9beceULL, 561, 188 },
+	{ 0x88fcf317f22241e2ULL, 588, 196 }, { 0xcc20ce9bd35c78a5ULL, 614, 204 },
+	{ 0x98165af37b2153dfULL, 641, 212 }, { 0xe2a0b5dc971f303aULL, 667, 220 },
+	{ 0xa8d9d1535ce3b396ULL, 694, 228 }, { 0xfb9b7cd9a4a7443cULL, 720, 236 },
+	{ 0xbb764c4ca7a44410ULL, 747, 244 }, { 0x8bab8eefb6409c1aULL, 774, 252 },
+	{ 0xd01fef10a657842cULL, 800, 260 }, { 0x9b10a4e5e9913129ULL, 827, 268 },
+	{ 0xe7109bfba19c0c9dULL, 853, 276 }, { 0xac2820d9623bf429ULL, 880, 284 },
+	{ 0x80444b5e7aa7cf85ULL, 907, 292 }, { 0xbf21e44003acdd2dULL, 933, 300 },
+	{ 0x8e679c2f5e44ff8fULL, 960, 308 }, { 0xd433179d9c8cb841ULL, 986, 316 },
+	{ 0x9e19db92b4e31ba9ULL, 1013, 324 }, { 0xeb96bf6ebadf77d9ULL, 1039, 332 },
+	{ 0xaf87023b9bf0ee6bULL, 1066, 340 },
+};
+
+static diy_fp diy_mul(diy_fp x, diy_fp y){
+	unsigned __int128 p = (unsigned __int128)x.f * y.f;
+	diy_fp r = { (uint64_t)(p >> 64) + ((uint64_t)p >> 63), x.e + y.e + 64 };
+	return r;
+}
+
+static diy_fp normalize(diy_fp x){
+	int s = __builtin_clzll(x.f);
+	x.f <<= s;
+	x.e -= s;
+	return x;
+}
+
+/* a cached 10^mk that brings the product's exponent into [-60, -32] */
+static diy_fp cached_power(int e, int *mk){
+	double dk = (-60 - (e + 64) + 63) * 0.30102999566398114;
+	int k = (int)dk;
+	if(k < dk)
+		k++;
+	int i = (348 + k - 1) / 8 + 1;
+	*mk = cached_powers[i].k;
+	return (diy_fp){ cached_powers[i].f, cached_powers[i].e };
+}
+
+/* move the last digit towards w while that stays safe, then check the
+   answer can't be some other digit string of the same length */
+static int round_weed(char *buf, int len, uint64_t dist_high_w, uint64_t unsafe,
+		      uint64_t rest, uint64_t ten_kappa, uint64_t unit){
+	uint64_t small = dist_high_w - unit, big = dist_high_w + unit;
+	while(rest < small && unsafe - rest >= ten_kappa
+	      && (rest + ten_kappa < small || small - rest >= rest + ten_kappa - small)){
+		buf[len - 1]--;
+		rest += ten_kappa;
+	}
+	if(rest < big && unsafe - rest >= ten_kappa
+	   && (rest + ten_kappa < big || big - rest > rest + ten_kappa - big))
+		return 0;
+	return 2 * unit <= rest && rest <= unsafe - 4 * unit;
+}
+
+static int digit_gen(diy_fp low, diy_fp w, diy_fp high, char *buf, int *len, int *kappa){
+	uint64_t unit = 1;
+	diy_fp too_low = { low.f - unit, low.e }, too_high = { high.f + unit, high.e };
+	uint64_t unsafe = too_high.f - too_low.f;
+	int shift = -w.e;
+	uint64_t one = 1ULL << shift;
+	uint32_t integrals = too_high.f >> shift;
+	uint64_t fractionals = too_high.f & (one - 1);
+
+	int k = fmt_dec_len(integrals);
+	uint32_t divisor = pow10[k - 1];
+	*len = 0;
+	while(k > 0){
+		buf[(*len)++] = '0' + integrals / divisor;
+		integrals %= divisor;
+		k--;
+		uint64_t rest = ((uint64_t)integrals << shift) + fractionals;
+		if(rest < unsafe){
+			*kappa = k;
+			return round_weed(buf, *len, too_high.f - w.f, unsafe, rest,
+					  (uint64_t)divisor << shift, unit);
+		}
+		divisor /= 10;
+	}
+	for (;;){
+		fractionals *= 10;
+		unit *= 10;
+		unsafe *= 10;
+		buf[(*len)++] = '0' + (fractionals >> shift);
+		fractionals &= one - 1;
+		k--;
+		if(fractionals < unsafe){
+			*kappa = k;
+			return round_weed(buf, *len, (too_high.f - w.f) * unit, unsafe, fractionals, one, unit);
+		}
+	}
+}
+
+static int grisu3(double v, char *buf, int *exp10){
+	uint64_t bits;
+	memcpy(&bits, &v, sizeof bits);
+	uint64_t frac = bits & ((1ULL << 52) - 1);
+	int bexp = bits >> 52 & 0x7ff;
+	diy_fp w = bexp ? (diy_fp){ frac | 1ULL << 52, bexp - 1075 } : (diy_fp){ frac, -1074 };
+
+	/* the halfway points to the neighbours; below a power of two the
+	   lower neighbour is half as far away */
+	diy_fp plus = normalize((diy_fp){ (w.f << 1) + 1, w.e - 1 });
+	diy_fp minus = frac == 0 && bexp > 1 ? (diy_fp){ (w.f << 2) - 1, w.e - 2 }
+					     : (diy_fp){ (w.f << 1) - 1, w.e - 1 };
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+	w = normalize(w);
+
+	int mk, len, kappa;
+	diy_fp c = cached_power(w.e, &mk);
+	if(!digit_gen(diy_mul(minus, c), diy_mul(w, c), diy_mul(plus, c), buf, &len, &kappa))
+		return 0;
+	*exp10 = kappa - mk;
+	return len;
+}
+
+/* the slow way, exact because glibc's %e and strtod are. If p digits
+   read back so do p + 1, so the shortest p can be bisected */
+static int exact_digits(double v, char *buf, int *exp10){
+	char tmp[32];
+	int lo = 1, hi = 17;
+	while(lo < hi){
+		int p = (lo + hi) / 2;
+		snprintf(tmp, sizeof tmp, "%.*e", p - 1, v);
+		if(strtod(tmp, NULL) == v)
+			hi = p;
+		else
+			lo = p + 1;
+	}
+	snprintf(tmp, sizeof tmp, "%.*e", lo - 1, v);
+	int len = 0;
+	char *s = tmp;
+	for (; *s != 'e'; s++)
+		if(*s != '.')
+			buf[len++] = *s;
+	*exp10 = atoi(s + 1) - (len - 1);
+	return len;
+}
+
+int fmt_double_digits(char *digits, double v, int *exp10){
+	int len = grisu3(v, digits, exp10);
+	if(len == 0)
+		len = exact_digits(v, digits, exp10);
+	while(len > 1 && digits[len - 1] == '0'){
+		len--;
+		(*exp10)++;
+	}
+	return len;
+}
+
+/* d[0..k) are the digits of 0.d * 10^(*E + 1). Round to p digits,
+   half away from the shortest digits. -1 for an exact tie, which the
+   shortest digits can't settle */
+static int round_digits(char *d, int k, int p, int *E){
+	if(p >= k)
+		return k;
+	if(p < 0){
+		*E = -1;
+		return 0;
+	}
+	if(d[p] == '5' && p + 1 == k)
+		return -1;
+	if(d[p] < '5'){
+		if(p == 0)
+			*E = -1;
+		return p;
+	}
+	int i = p;
+	while(i > 0 && d[i - 1] == '9')
+		i--;
+	if(i == 0){
+		d[0] = '1';
+		(*E)++;
+		return 1;
+	}
+	d[i - 1]++;
+	return i;
+}
+
+static char digit_at(const char *d, int k, int i){
+	return i >= 0 && i < k ? d[i] : '0';
+}
+
+int fmt_double(char *out, size_t size, double v, char conv, int prec, int alt){
+	char d[24];
+	int k, E, p;
+	char lower = conv | 0x20;
+
+	if(prec < 0)
+		prec = 6;
+	if(v == 0){
+		d[0] = '0';
+		k = 1;
+		E = 0;
+	}else{
+		int x;
+		k = fmt_double_digits(d, v, &x);
+		E = x + k - 1;
+	}
+	p = lower == 'e' ? prec + 1 : lower == 'f' ? E + 1 + prec : prec ? prec : 1;
+
+	/* zeros after the shortest digits are only right while the doubles
+	   are finer than the decimals asked for: 15 digits, no subnormals */
+	if(k < p && v != 0 && (p > 15 || v < 0x1p-1022))
+		return -1;
+	int E0 = E;
+	if((k = round_digits(d, k, p, &E)) < 0)
+		return -1;
+
+	int fixed = lower == 'f';
+	if(lower == 'g'){
+		fixed = p > E && E >= -4;
+		prec = fixed ? p - 1 - E : p - 1;
+		/* glibc keeps the precision of the fixed form when rounding
+		   carries into the exponent form: %#.3g of 999.9 is 1.e+03 */
+		if(!fixed && p > E0 && E0 >= -4)
+			prec = p - 1 - E0;
+	}
+
+	size_t need = fixed ? (E > 0 ? E + 1 : 1) + 1 + prec : prec + 8;
+	if(need > size)
+		return -1;
+
+	int n = 0;
+	if(fixed){
+		if(E < 0)
+			out[n++] = '0';
+		for (int i = 0; i <= E; i++)
+			out[n++] = digit_at(d, k, i);
+		if(prec > 0 || alt)
+			out[n++] = '.';
+		for (int j = 1; j <= prec; j++)
+			out[n++] = digit_at(d, k, E + j);
+	}else{
+		out[n++] = d[0];
+		if(prec > 0 || alt)
+			out[n++] = '.';
+		for (int j = 1; j <= prec; j++)
+			out[n++] = digit_at(d, k, j);
+	}
+	if(lower == 'g' && !alt && prec > 0){
+		while(out[n - 1] == '0')
+			n--;
+		if(out[n - 1] == '.')
+			n--;
+	}
+	if(!fixed){
+		int x = E < 0 ? -E : E;
+		out[n++] = conv == 'E' || conv == 'G' ? 'E' : 'e';
+		out[n++] = E < 0 ? '-' : '+';
+		if(x >= 100)
+			out[n++] = '0' + x / 100;
+		memcpy(out + n, two_digits + 2 * (x % 100), 2);
+		n += 2;
+	}
+	return n;
+}
+
+int fmt_double_shortest(char *out, double v){
+	int n = 0;
+	if(signbit(v))
+		out[n++] = '-';
+	if(isnan(v) || isinf(v))
+		return n + sprintf(out + n, isnan(v) ? "nan" : "inf");
+	v = fabs(v);
+
+	char d[24];
+	int x, k = v == 0 ? (d[0] = '0', x = 0, 1) : fmt_double_digits(d, v, &x);
+	n += fmt_double(out + n, FMT_SHORTEST_MAX - n, v, 'g', k, 0);
+	out[n] = '\0';
+	return n;
+}
@@ -0,0 +1,42 @@
+#ifndef FMT_NUM_H
+#define FMT_NUM_H
+/* number to text without going through printf.
+
+   Integers: the digits only, no sign or padding, written from out[0],
+   length returned, no '\0'. Decimal goes two digits at a time from a
+   table, the length is known up front from the bit length.
+
+   Doubles: fmt_double_digits finds the shortest digit string that
+   reads back as the same double (Grisu3; the few values Grisu3 can't
+   decide go through the exact %.*e and strtod search). fmt_double
+   turns those digits into %e %f %g text, identical to glibc, or
+   returns -1 when that can't be done from the shortest digits (more
+   than 15 significant digits asked for, an exact tie, ...), in which
+   case the caller has to ask snprintf. */
+#include <stddef.h>
+#include <stdint.h>
+
+#define FMT_DEC_MAX 20
+#define FMT_HEX_MAX 16
+#define FMT_OCT_MAX 22
+#define FMT_SHORTEST_MAX 32
+
+int fmt_dec_len(uint64_t v);
+int fmt_u64_dec(char *out, uint64_t v);
+int fmt_u64_hex(char *out, uint64_t v, int upper);
+int fmt_u64_oct(char *out, uint64_t v);
+
+/* v finite and > 0: v reads back from digits * 10^*exp10.
+   digits gets at most 17 characters, their count is returned */
+int fmt_double_digits(char *digits, double v, int *exp10);
+
+/* v finite and >= 0 (the sign is the caller's), conv one of e E f F g G,
+   prec < 0 for the default. Returns the length, or -1 as above or
+   when it doesn't fit in size */
+int fmt_double(char *out, size_t size, double v, char conv, int prec, int alt);
+
+/* what %.<n>g gives with the smallest n that reads back as v,
+   "-0", "inf" & co included. '\0' terminated, length returned */
+int fmt_double_shortest(char *out, double v);
+
+#endif
@@ -0,0 +1,160 @@
+/* fmt_num.c checked against glibc, then timed against it.
+
+	./fmt_num_bench [values]
+
+   The check formats `values` random integers and doubles (default ten
+   million, give it a few hundred million for a proper run) with
+   mini_snprintf and snprintf and compares the bytes, and compares
+   fmt_double_shortest with the smallest %.<n>g that reads back.
+   Doubles are half random bit patterns, half "human" numbers (an
+   integer over a power of ten). It also counts how often fmt_double
+   had to leave a conversion to snprintf.
+
+   gcc -O2 fmt_num_bench.c fmt_num.c mini_format.c -o fmt_num_bench */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fmt_num.h"
+#include "mini_format.h"
+
+#define TIMED 1000000
+
+static uint64_t state = 88172645463325252ULL;
+
+static uint64_t next(void){
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+/* every bit length equally likely, not mostly 19 digit numbers */
+static uint64_t random_int(void){
+	return next() >> (next() & 63);
+}
+
+static double random_double(long i){
+	if(i & 1){
+		double d;
+		do{
+			uint64_t bits = next();
+			memcpy(&d, &bits, sizeof d);
+		}while(!isfinite(d));
+		return d;
+	}
+	static const double scale[] = { 1, 10, 100, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11 };
+	return (int64_t)random_int() / scale[next() % 12];
+}
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long mismatches;
+
+static void report(const char *fmt, const char *want, const char *got){
+	if(mismatches++ < 20)
+		printf("MISMATCH %-8s glibc [%s] ours [%s]\n", fmt, want, got);
+}
+
+#define CHECK(fmt, v) do{                                               \
+	char want[400], got[400];                                       \
+	snprintf(want, sizeof want, fmt, v);                            \
+	mini_snprintf(got, sizeof got, fmt, v);                         \
+	if(strcmp(want, got) != 0)                                      \
+		report(fmt, want, got);                                 \
+}while(0)
+
+static void check_int(unsigned long long u){
+	long long s = (long long)u;
+	CHECK("%llu", u);
+	CHECK("%lld", s);
+	CHECK("%llx", u);
+	CHECK("%llX", u);
+	CHECK("%llo", u);
+	CHECK("%#llo", u);
+	CHECK("%#llx", u);
+	CHECK("%25llu", u);
+	CHECK("%-8.12lld", s);
+	CHECK("%+d", (int)s);
+	CHECK("%05d", (int)s);
+	CHECK("%.0u", (unsigned)(u & 3));
+}
+
+static long fallbacks, float_convs;
+
+static void check_double(double v){
+	static const char *fmts[] = { "%e", "%f", "%g", "%.3f", "%.0f", "%.2e", "%.10g",
+				      "%.15g", "%.17g", "%#.3g", "%+.1E", "%12.4f" };
+	static const char conv[] = { 'e', 'f', 'g', 'f', 'f', 'e', 'g', 'g', 'g', 'g', 'E', 'f' };
+	static const int prec[] = { -1, -1, -1, 3, 0, 2, 10, 15, 17, 3, 1, 4 };
+	char body[400];
+	for (int i = 0; i < 12; i++){
+		CHECK(fmts[i], v);
+		float_convs++;
+		if(fmt_double(body, sizeof body, fabs(v), conv[i], prec[i], i == 9) < 0)
+			fallbacks++;
+	}
+
+	char want[40], got[FMT_SHORTEST_MAX];
+	int p;
+	for (p = 1; p < 17; p++){
+		snprintf(want, sizeof want, "%.*g", p, v);
+		if(strtod(want, NULL) == v)
+			break;
+	}
+	snprintf(want, sizeof want, "%.*g", p, v);
+	fmt_double_shortest(got, v);
+	if(strcmp(want, got) != 0)
+		report("shortest", want, got);
+}
+
+static uint64_t ints[TIMED];
+static double doubles[TIMED];
+
+#define TIME(label, expr) do{                                           \
+	double t0 = now();                                              \
+	long sum = 0;                                                   \
+	for (int i = 0; i < TIMED; i++)                                 \
+		sum += (expr);                                          \
+	printf("%-34s %8.1f ns  (%ld)\n", label, (now() - t0) / TIMED * 1e9, sum); \
+}while(0)
+
+int main(int argc, char *argv[]){
+	long n = argc > 1 ? atol(argv[1]) : 10000000;
+	double t0 = now();
+	for (long i = 0; i < n; i++){
+		check_int(random_int());
+		check_double(random_double(i));
+	}
+	printf("checked %ld integers and %ld doubles in %.0f s: %ld mismatches\n",
+	       n, n, now() - t0, mismatches);
+	printf("fmt_double left %.2f%% of %%e/%%f/%%g conversions to snprintf\n\n",
+	       100.0 * fallbacks / float_convs);
+
+	for (int i = 0; i < TIMED; i++){
+		ints[i] = random_int();
+		doubles[i] = random_double(i & ~1L);    /* human numbers only */
+	}
+	char buf[400];
+	TIME("snprintf %llu", snprintf(buf, sizeof buf, "%llu", (unsigned long long)ints[i]));
+	TIME("fmt_u64_dec", fmt_u64_dec(buf, ints[i]));
+	TIME("snprintf %llx", snprintf(buf, sizeof buf, "%llx", (unsigned long long)ints[i]));
+	TIME("fmt_u64_hex", fmt_u64_hex(buf, ints[i], 0));
+	TIME("snprintf %d", snprintf(buf, sizeof buf, "%d", (int)ints[i]));
+	TIME("mini_snprintf %d", mini_snprintf(buf, sizeof buf, "%d", (int)ints[i]));
+	TIME("snprintf %.17g", snprintf(buf, sizeof buf, "%.17g", doubles[i]));
+	TIME("fmt_double_shortest", fmt_double_shortest(buf, doubles[i]));
+	TIME("snprintf %.3f", snprintf(buf, sizeof buf, "%.3f", doubles[i]));
+	TIME("mini_snprintf %.3f", mini_snprintf(buf, sizeof buf, "%.3f", doubles[i]));
+	TIME("snprintf %g", snprintf(buf, sizeof buf, "%g", doubles[i]));
+	TIME("mini_snprintf %g", mini_snprintf(buf, sizeof buf, "%g", doubles[i]));
+	TIME("snprintf %e", snprintf(buf, sizeof buf, "%e", doubles[i]));
+	TIME("mini_snprintf %e", mini_snprintf(buf, sizeof buf, "%e", doubles[i]));
+	return mismatches != 0;
+}
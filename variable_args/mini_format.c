@@ -0,0 +1,436 @@
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "fmt_num.h"
+#include "mini_format.h"
+
+/* shared by every sink on this thread that didn't bring its own buffer,
+   so one of those has to be finished before the next one starts */
+static _Thread_local char tls_buf[MINI_FORMAT_TLS_BUFSIZE];
+
+enum { LEN_NONE, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_J, LEN_Z, LEN_T, LEN_BIG_L };
+
+typedef struct{
+	int left, plus, space, alt, zero;
+	int width, prec;        /* prec -1: none given */
+	int len;
+	char conv;
+}spec;
+
+void sink_string(sink *s, char *buf, size_t size){
+	*s = (sink){ .buf = buf, .cap = size, .kind = SINK_STRING };
+}
+
+void sink_fd(sink *s, int fd, char *buf, size_t size){
+	if(buf == NULL){
+		buf = tls_buf;
+		size = sizeof tls_buf;
+	}
+	*s = (sink){ .buf = buf, .cap = size, .kind = SINK_FD, .fd = fd };
+}
+
+void sink_file(sink *s, FILE *fp, char *buf, size_t size){
+	if(buf == NULL){
+		buf = tls_buf;
+		size = sizeof tls_buf;
+	}
+	*s = (sink){ .buf = buf, .cap = size, .kind = SINK_FILE, .fp = fp };
+}
+
+static int write_all(int fd, struct iovec *iov, int cnt){
+	while(cnt > 0){
+		ssize_t n = writev(fd, iov, cnt);
+		if(n == -1){
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		while(cnt > 0 && (size_t)n >= iov->iov_len){
+			n -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+		if(cnt > 0){
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+	return 0;
+}
+
+/* what is buffered, then p, in one call */
+static void drain(sink *s, const char *p, size_t n){
+	if(s->len == 0 && n == 0)
+		return;
+	if(!s->error && s->kind == SINK_FD){
+		struct iovec iov[2] = { { s->buf, s->len }, { (void *)p, n } };
+		if(write_all(s->fd, iov, n ? 2 : 1) == -1)
+			s->error = 1;
+	}else if(!s->error){
+		if(s->len && fwrite(s->buf, 1, s->len, s->fp) != s->len)
+			s->error = 1;
+		else if(n && fwrite(p, 1, n, s->fp) != n)
+			s->error = 1;
+	}
+	s->len = 0;
+}
+
+void sink_put(sink *s, const char *p, size_t n){
+	s->total += n;
+	if(s->kind == SINK_STRING){
+		size_t room = s->cap ? s->cap - 1 - s->len : 0;
+		if(n > room)
+			n = room;
+		if(n){
+			memcpy(s->buf + s->len, p, n);
+			s->len += n;
+		}
+		return;
+	}
+	if(n <= s->cap - s->len){
+		memcpy(s->buf + s->len, p, n);
+		s->len += n;
+		return;
+	}
+	/* doesn't fit: a big piece goes out right behind the buffer,
+	   a small one starts the next buffer */
+	if(n >= s->cap / 2){
+		drain(s, p, n);
+		return;
+	}
+	drain(s, NULL, 0);
+	memcpy(s->buf, p, n);
+	s->len = n;
+}
+
+static void sink_pad(sink *s, char c, size_t n){
+	static const char spaces[] = "                                ";
+	static const char zeros[] = "00000000000000000000000000000000";
+	const char *fill = c == '0' ? zeros : spaces;
+	while(n > 0){
+		size_t k = n < sizeof spaces - 1 ? n : sizeof spaces - 1;
+		sink_put(s, fill, k);
+		n -= k;
+	}
+}
+
+int sink_flush(sink *s){
+	if(s->kind != SINK_STRING)
+		drain(s, NULL, 0);
+	return s->error ? -1 : 0;
+}
+
+int sink_finish(sink *s){
+	if(s->kind == SINK_STRING){
+		if(s->cap)
+			s->buf[s->len] = '\0';
+	}else
+		sink_flush(s);
+	if(s->error)
+		return -1;
+	if(s->total > INT_MAX){
+		errno = EOVERFLOW;
+		return -1;
+	}
+	return (int)s->total;
+}
+
+/* [spaces] [sign or 0x] [zeros] digits [spaces] */
+static void put_field(sink *s, const spec *sp, const char *prefix, size_t np,
+		      const char *digits, size_t n, size_t zeros){
+	size_t used = np + zeros + n;
+	size_t pad = (size_t)sp->width > used ? sp->width - used : 0;
+	if(pad && !sp->left)
+		sink_pad(s, ' ', pad);
+	if(np)
+		sink_put(s, prefix, np);
+	if(zeros)
+		sink_pad(s, '0', zeros);
+	sink_put(s, digits, n);
+	if(pad && sp->left)
+		sink_pad(s, ' ', pad);
+}
+
+static void put_int(sink *s, const spec *sp, unsigned long long v, int neg){
+	char p[FMT_OCT_MAX];
+	unsigned base = sp->conv == 'o' ? 8 : sp->conv == 'x' || sp->conv == 'X' || sp->conv == 'p' ? 16 : 10;
+	size_t n = v == 0 && sp->prec == 0 ? 0
+		 : base == 10 ? fmt_u64_dec(p, v)
+		 : base == 16 ? fmt_u64_hex(p, v, sp->conv == 'X')
+		 : fmt_u64_oct(p, v);
+	char prefix[2];
+	size_t np = 0;
+
+	if(sp->conv == 'd' || sp->conv == 'i'){
+		if(neg)
+			prefix[np++] = '-';
+		else if(sp->plus)
+			prefix[np++] = '+';
+		else if(sp->space)
+			prefix[np++] = ' ';
+	}else if(sp->alt && base == 16 && v != 0){
+		prefix[np++] = '0';
+		prefix[np++] = sp->conv == 'X' ? 'X' : 'x';
+	}
+	size_t prec = sp->prec < 0 ? 0 : sp->prec;
+	if(sp->alt && base == 8 && (n == 0 || *p != '0') && prec <= n)
+		prec = n + 1;
+	size_t zeros = prec > n ? prec - n : 0;
+	if(sp->prec < 0 && sp->zero && !sp->left && (size_t)sp->width > np + n)
+		zeros = sp->width - np - n;
+	put_field(s, sp, prefix, np, p, n, zeros);
+}
+
+static void put_str(sink *s, const spec *sp, const char *str){
+	if(str == NULL)
+		str = sp->prec < 0 || sp->prec >= 6 ? "(null)" : "";
+	size_t n = sp->prec < 0 ? strlen(str) : strnlen(str, sp->prec);
+	put_field(s, sp, NULL, 0, str, n, 0);
+}
+
+/* %e %f %g of a double from its shortest digits when that is exact,
+   everything else (%a, long double, inf, nan, too many digits) through
+   snprintf into our buffer */
+static void put_float(sink *s, const spec *sp, long double v){
+	char f[16], tmp[128], *out = tmp;
+	char lower = sp->conv | 0x20;
+	if(sp->len != LEN_BIG_L && lower != 'a' && isfinite(v)){
+		double d = v;
+		int n = fmt_double(tmp, sizeof tmp, signbit(d) ? -d : d, sp->conv, sp->prec, sp->alt);
+		if(n >= 0){
+			char prefix = signbit(d) ? '-' : sp->plus ? '+' : ' ';
+			size_t np = signbit(d) || sp->plus || sp->space;
+			size_t zeros = sp->zero && !sp->left && (size_t)sp->width > np + n ? sp->width - np - n : 0;
+			put_field(s, sp, &prefix, np, tmp, n, zeros);
+			return;
+		}
+	}
+	int k = 0;
+	f[k++] = '%';
+	if(sp->left) f[k++] = '-';
+	if(sp->plus) f[k++] = '+';
+	if(sp->space) f[k++] = ' ';
+	if(sp->alt) f[k++] = '#';
+	if(sp->zero) f[k++] = '0';
+	f[k++] = '*';
+	f[k++] = '.';
+	f[k++] = '*';
+	if(sp->len == LEN_BIG_L) f[k++] = 'L';
+	f[k++] = sp->conv;
+	f[k] = '\0';
+
+	int prec = sp->prec;    /* negative is the same as none */
+	int n = sp->len == LEN_BIG_L ? snprintf(tmp, sizeof tmp, f, sp->width, prec, v)
+				     : snprintf(tmp, sizeof tmp, f, sp->width, prec, (double)v);
+	if(n >= (int)sizeof tmp && (out = malloc(n + 1)) != NULL){
+		if(sp->len == LEN_BIG_L)
+			snprintf(out, n + 1, f, sp->width, prec, v);
+		else
+			snprintf(out, n + 1, f, sp->width, prec, (double)v);
+	}
+	if(out == NULL){
+		s->error = 1;
+		return;
+	}
+	if(n > 0)
+		sink_put(s, out, n);
+	if(out != tmp)
+		free(out);
+}
+
+int mini_vformat(sink *s, const char *fmt, va_list args){
+	size_t start = s->total;
+	va_list ap;
+	va_copy(ap, args);
+
+	while(*fmt){
+		const char *pct = strchr(fmt, '%');
+		if(pct == NULL){
+			sink_put(s, fmt, strlen(fmt));
+			break;
+		}
+		if(pct > fmt)
+			sink_put(s, fmt, pct - fmt);
+		fmt = pct + 1;
+
+		spec sp = { .prec = -1 };
+		for (;; fmt++){
+			if(*fmt == '-') sp.left = 1;
+			else if(*fmt == '+') sp.plus = 1;
+			else if(*fmt == ' ') sp.space = 1;
+			else if(*fmt == '#') sp.alt = 1;
+			else if(*fmt == '0') sp.zero = 1;
+			else break;
+		}
+		if(*fmt == '*'){
+			sp.width = va_arg(ap, int);
+			if(sp.width < 0){
+				sp.left = 1;
+				sp.width = -sp.width;
+			}
+			fmt++;
+		}else
+			while(*fmt >= '0' && *fmt <= '9')
+				sp.width = sp.width * 10 + *fmt++ - '0';
+		if(*fmt == '.'){
+			fmt++;
+			sp.prec = 0;
+			if(*fmt == '*'){
+				sp.prec = va_arg(ap, int);
+				if(sp.prec < 0)
+					sp.prec = -1;
+				fmt++;
+			}else
+				while(*fmt >= '0' && *fmt <= '9')
+					sp.prec = sp.prec * 10 + *fmt++ - '0';
+		}
+		switch(*fmt){
+			case 'h': sp.len = fmt[1] == 'h' ? LEN_HH : LEN_H; break;
+			case 'l': sp.len = fmt[1] == 'l' ? LEN_LL : LEN_L; break;
+			case 'j': sp.len = LEN_J; break;
+			case 'z': sp.len = LEN_Z; break;
+			case 't': sp.len = LEN_T; break;
+			case 'L': sp.len = LEN_BIG_L; break;
+		}
+		if(sp.len != LEN_NONE)
+			fmt += sp.len == LEN_HH || sp.len == LEN_LL ? 2 : 1;
+		sp.conv = *fmt;
+		if(*fmt == '\0'){
+			sink_put(s, pct, fmt - pct);
+			break;
+		}
+		fmt++;
+
+		switch(sp.conv){
+			case 'd':
+			case 'i':{
+				long long v;
+				switch(sp.len){
+					case LEN_HH: v = (signed char)va_arg(ap, int); break;
+					case LEN_H: v = (short)va_arg(ap, int); break;
+					case LEN_L: v = va_arg(ap, long); break;
+					case LEN_LL: v = va_arg(ap, long long); break;
+					case LEN_J: v = va_arg(ap, intmax_t); break;
+					case LEN_Z: v = va_arg(ap, ssize_t); break;
+					case LEN_T: v = va_arg(ap, ptrdiff_t); break;
+					default: v = va_arg(ap, int); break;
+				}
+				put_int(s, &sp, v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v, v < 0);
+				break;
+			}
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':{
+				unsigned long long v;
+				switch(sp.len){
+					case LEN_HH: v = (unsigned char)va_arg(ap, unsigned); break;
+					case LEN_H: v = (unsigned short)va_arg(ap, unsigned); break;
+					case LEN_L: v = va_arg(ap, unsigned long); break;
+					case LEN_LL: v = va_arg(ap, unsigned long long); break;
+					case LEN_J: v = va_arg(ap, uintmax_t); break;
+					case LEN_Z: v = va_arg(ap, size_t); break;
+					case LEN_T: v = (size_t)va_arg(ap, ptrdiff_t); break;
+					default: v = va_arg(ap, unsigned); break;
+				}
+				put_int(s, &sp, v, 0);
+				break;
+			}
+			case 'c':{
+				char c = (char)va_arg(ap, int);
+				put_field(s, &sp, NULL, 0, &c, 1, 0);
+				break;
+			}
+			case 's':
+				put_str(s, &sp, va_arg(ap, const char *));
+				break;
+			case 'p':{
+				void *p = va_arg(ap, void *);
+				if(p == NULL){
+					sp.prec = -1;
+					put_str(s, &sp, "(nil)");
+				}else{
+					sp.alt = 1;
+					put_int(s, &sp, (uintptr_t)p, 0);
+				}
+				break;
+			}
+			case 'e': case 'E': case 'f': case 'F':
+			case 'g': case 'G': case 'a': case 'A':
+				put_float(s, &sp, sp.len == LEN_BIG_L ? va_arg(ap, long double) : va_arg(ap, double));
+				break;
+			case '%':
+				sink_put(s, "%", 1);
+				break;
+			default:        /* not ours, print it as written */
+				sink_put(s, pct, fmt - pct);
+				break;
+		}
+	}
+	va_end(ap);
+	return s->total - start > INT_MAX ? -1 : (int)(s->total - start);
+}
+
+int mini_format(sink *s, const char *fmt, ...){
+	va_list args;
+	va_start(args, fmt);
+	int n = mini_vformat(s, fmt, args);
+	va_end(args);
+	return n;
+}
+
+int mini_vprintf(const char *fmt, va_list args){
+	sink s;
+	sink_fd(&s, STDOUT_FILENO, NULL, 0);
+	mini_vformat(&s, fmt, args);
+	return sink_finish(&s);
+}
+
+int mini_printf(const char *fmt, ...){
+	va_list args;
+	va_start(args, fmt);
+	int n = mini_vprintf(fmt, args);
+	va_end(args);
+	return n;
+}
+
+int mini_vsnprintf(char *buf, size_t size, const char *fmt, va_list args){
+	sink s;
+	sink_string(&s, buf, size);
+	mini_vformat(&s, fmt, args);
+	return sink_finish(&s);
+}
+
+int mini_snprintf(char *buf, size_t size, const char *fmt, ...){
+	va_list args;
+	va_start(args, fmt);
+	int n = mini_vsnprintf(buf, size, fmt, args);
+	va_end(args);
+	return n;
+}
+
+int mini_fprintf(FILE *fp, const char *fmt, ...){
+	sink s;
+	va_list args;
+	sink_file(&s, fp, NULL, 0);
+	va_start(args, fmt);
+	mini_vformat(&s, fmt, args);
+	va_end(args);
+	return sink_finish(&s);
+}
+
+int mini_dprintf(int fd, const char *fmt, ...){
+	sink s;
+	va_list args;
+	sink_fd(&s, fd, NULL, 0);
+	va_start(args, fmt);
+	mini_vformat(&s, fmt, args);
+	va_end(args);
+	return sink_finish(&s);
+}
@@ -0,0 +1,56 @@
+#ifndef MINI_FORMAT_H
+#define MINI_FORMAT_H
+/* the formatting core behind mini_printf.
+
+   Everything is formatted into a buffer and handed on in one piece:
+   a string (snprintf style, truncates, counts the full length), a raw
+   fd (one write/writev per flush) or a FILE * (one fwrite, so one
+   stdio lock). The buffer is the caller's, or for the mini_*printf
+   calls a thread-local one.
+
+   Conversions: d i u o x X c s p % and e E f F g G a A, with the usual
+   flags (- + space # 0), width, precision (both may be *) and length
+   modifiers (hh h l ll j z t L). Integers and most %e %f %g come from
+   fmt_num.c, the rest of floating point from snprintf.
+
+   mini_printf writes to fd 1 directly, past stdio's stdout buffer.
+   Mixed with printf, fflush(stdout) first or the order is lost. */
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define MINI_FORMAT_TLS_BUFSIZE 4096
+
+enum { SINK_STRING, SINK_FD, SINK_FILE };
+
+typedef struct{
+	char *buf;
+	size_t len, cap;
+	int kind;
+	int fd;
+	FILE *fp;
+	size_t total;   /* everything formatted so far, truncated or not */
+	int error;
+}sink;
+
+/* buf == NULL (fd and FILE sinks) means the thread-local buffer */
+void sink_string(sink *s, char *buf, size_t size);
+void sink_fd(sink *s, int fd, char *buf, size_t size);
+void sink_file(sink *s, FILE *fp, char *buf, size_t size);
+
+void sink_put(sink *s, const char *p, size_t n);
+int sink_flush(sink *s);
+/* flushes (or terminates the string); total length or -1 */
+int sink_finish(sink *s);
+
+int mini_vformat(sink *s, const char *fmt, va_list args);
+int mini_format(sink *s, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+int mini_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+int mini_vprintf(const char *fmt, va_list args);
+int mini_snprintf(char *buf, size_t size, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+int mini_vsnprintf(char *buf, size_t size, const char *fmt, va_list args);
+int mini_fprintf(FILE *fp, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+int mini_dprintf(int fd, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#endif
@@ -1,40 +1,8 @@
-#include <stdio.h>
-#include <stdarg.h>
+/* the formatting itself lives in mini_format.c: everything goes into one
+   buffer and out with a single write, no putchar per character.
 
-void mini_printf(const char *fmt, ...){
-	va_list args;
-	va_start(args, fmt);
-	
-	while(*fmt){
-		if(*fmt == '%'){
-			fmt++;
-
-			switch(*fmt){
-				case 'd':
-				case 'i':
-					printf("%d", va_arg(args, int));
-					break;
-				case 's':
-					printf("%s", va_arg(args, char*));
-					break;
-				case 'c':
-					putchar((char)va_arg(args, int));
-					break;
-				case 'f':
-					printf("%f", va_arg(args, double));
-					break;
-				case '%':
-					putchar('%');
-					break;
-			}
-		}
-		else{
-			putchar(*fmt);
-		}
-		fmt++;
-	}
-	va_end(args);
-}
+   gcc mini_printf.c mini_format.c fmt_num.c -o mini_printf */
+#include "mini_format.h"
 
 int main(void){
 	mini_printf("Hi %s, age: %d,  grade: %c, height: %f%%\n",
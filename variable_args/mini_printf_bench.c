@@ -0,0 +1,138 @@
+/* mini_format against glibc for a few log-line shapes, ns per line.
+
+	./mini_printf_bench [lines]
+
+   Output goes to /dev/null (stdout is pointed there too), the table
+   goes to stderr. "old mini_printf" is the putchar/printf version this
+   replaced, it only knows %d %s %c %f so it only runs the first shape.
+   Note that mini_printf does one write per call while printf to a
+   file is fully buffered; the batched sink is the fair comparison for
+   bulk output, mini_printf is the one for line at a time logging.
+
+   gcc -O2 mini_printf_bench.c mini_format.c fmt_num.c -o mini_printf_bench */
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "mini_format.h"
+
+enum { SNPRINTF, MINI_SNPRINTF, PRINTF, MINI_PRINTF, OLD_MINI_PRINTF, FPRINTF, MINI_FPRINTF, BATCHED };
+
+static const char *names[] = { "snprintf", "mini_snprintf", "printf", "mini_printf",
+			       "old mini_printf", "fprintf", "mini_fprintf", "batched sink 64K" };
+
+static double now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the mini_printf from before mini_format.c */
+static void old_mini_printf(const char *fmt, ...){
+	va_list args;
+	va_start(args, fmt);
+	while(*fmt){
+		if(*fmt == '%'){
+			fmt++;
+			switch(*fmt){
+				case 'd':
+				case 'i':
+					printf("%d", va_arg(args, int));
+					break;
+				case 's':
+					printf("%s", va_arg(args, char*));
+					break;
+				case 'c':
+					putchar((char)va_arg(args, int));
+					break;
+				case 'f':
+					printf("%f", va_arg(args, double));
+					break;
+				case '%':
+					putchar('%');
+					break;
+			}
+		}
+		else{
+			putchar(*fmt);
+		}
+		fmt++;
+	}
+	va_end(args);
+}
+
+static FILE *devnull;
+static sink batch;
+static char batchbuf[1 << 16];
+
+/* every shape goes through here so all the variants see the same calls */
+#define EMIT(how, ...) do{                                                      \
+	char line[256];                                                         \
+	switch(how){                                                            \
+		case SNPRINTF: snprintf(line, sizeof line, __VA_ARGS__); break; \
+		case MINI_SNPRINTF: mini_snprintf(line, sizeof line, __VA_ARGS__); break; \
+		case PRINTF: printf(__VA_ARGS__); break;                        \
+		case MINI_PRINTF: mini_printf(__VA_ARGS__); break;              \
+		case FPRINTF: fprintf(devnull, __VA_ARGS__); break;             \
+		case MINI_FPRINTF: mini_fprintf(devnull, __VA_ARGS__); break;   \
+		case BATCHED: mini_format(&batch, __VA_ARGS__); break;          \
+	}                                                                       \
+}while(0)
+
+static const char *levels[] = { "INFO", "WARN", "ERROR", "DEBUG" };
+static const char *files[] = { "main.c", "server/conn.c", "util.c" };
+
+static void shape_plain(int how, long i){
+	if(how == OLD_MINI_PRINTF)
+		old_mini_printf("[%s] %s:%d: %s\n", levels[i & 3], files[i % 3], (int)(i % 1000),
+				"connection accepted");
+	else
+		EMIT(how, "[%s] %s:%d: %s\n", levels[i & 3], files[i % 3], (int)(i % 1000),
+		     "connection accepted");
+}
+
+static void shape_request(int how, long i){
+	EMIT(how, "req=%lu status=%d bytes=%zu time=%.3f ms\n", (unsigned long)i * 7919,
+	     200 + (int)(i % 5), (size_t)(i * 37 % 100000), (i % 1000) / 7.0);
+}
+
+static void shape_padded(int how, long i){
+	EMIT(how, "%08x %-12s|%6d|%c\n", (unsigned)(i * 2654435761u), files[i % 3], (int)(i % 100000) - 500,
+	     'a' + (int)(i % 26));
+}
+
+static void run(const char *shape, void (*fn)(int, long), int how, long lines){
+	if(how == BATCHED)
+		sink_fd(&batch, STDOUT_FILENO, batchbuf, sizeof batchbuf);
+	double t0 = now();
+	for (long i = 0; i < lines; i++)
+		fn(how, i);
+	if(how == BATCHED)
+		sink_finish(&batch);
+	fflush(stdout);
+	fflush(devnull);
+	fprintf(stderr, "%-10s %-18s %8.1f\n", shape, names[how], (now() - t0) / lines * 1e9);
+}
+
+int main(int argc, char *argv[]){
+	long lines = argc > 1 ? atol(argv[1]) : 1000000;
+	int null = open("/dev/null", O_WRONLY);
+	devnull = fopen("/dev/null", "w");
+	if(null == -1 || devnull == NULL || dup2(null, STDOUT_FILENO) == -1){
+		perror("/dev/null");
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stderr, "%-10s %-18s %8s\n", "shape", "", "ns/line");
+	for (int how = SNPRINTF; how <= BATCHED; how++)
+		run("plain", shape_plain, how, lines);
+	for (int how = SNPRINTF; how <= BATCHED; how++)
+		if(how != OLD_MINI_PRINTF)
+			run("request", shape_request, how, lines);
+	for (int how = SNPRINTF; how <= BATCHED; how++)
+		if(how != OLD_MINI_PRINTF)
+			run("padded", shape_padded, how, lines);
+	return 0;
+}
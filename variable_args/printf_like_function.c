@@ -1,6 +1,13 @@
+/* warning() no longer formats on the spot: dlog.c keeps the format
+   string's id and the raw arguments and a background thread writes
+   the text to stderr.
+
+   gcc -pthread printf_like_function.c dlog.c mini_format.c fmt_num.c */
 #include <stdarg.h>
 #include <stdio.h>
-#define warning(...) (fprintf(stderr, __VA_ARGS__))
+#include <unistd.h>
+#include "dlog.h"
+#define warning(...) DLOG(__VA_ARGS__)
 
 void myprint(const char *fmt, ...){
 	va_list args;
@@ -10,7 +17,10 @@ void myprint(const char *fmt, ...){
 }
 
 int main(void){
+	dlog_options opt = { STDERR_FILENO, 0, 0 };
+	dlog_init(&opt);
 	warning("Hey there how are you i am %i year %s.\n", 21, "old");
 	myprint("Name: %s, Age: %d\n", "Ada", 20);
+	dlog_shutdown();
 	return 0;
 }